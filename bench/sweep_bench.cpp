@@ -0,0 +1,42 @@
+// Cost of whole-level sweeps by level depth. A sweep splices each level's FIFO onto the free
+// list in one step but still visits every maker once (handle release, hash toggle), so the
+// cost is per level plus per maker; this prints both for a range of depths.
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include "MatchingEngine.hpp"
+
+namespace {
+
+using Engine = MatchingEngine<4096, 1u << 20>;
+constexpr uint32_t LEVELS = 16;
+constexpr uint32_t FIRST_TICK = 1000;
+
+// Mean ns of one taker sweeping LEVELS ask levels of 'depth' makers each
+double sweep_ns(Engine& eng, uint32_t depth, uint32_t rounds) {
+    double total = 0.0;
+    for (uint32_t r = 0; r < rounds; ++r) {
+        for (uint32_t l = 0; l < LEVELS; ++l)
+            for (uint32_t d = 0; d < depth; ++d)
+                eng.add_limit(OrderIn{.client_id=0,.price_tick=FIRST_TICK + l,.qty=1,.side=SIDE_SELL,.flags=0});
+        const OrderIn taker{.client_id=0,.price_tick=FIRST_TICK + LEVELS - 1,.qty=LEVELS * depth,.side=SIDE_BUY,.flags=0};
+        const auto t0 = std::chrono::steady_clock::now();
+        eng.add_limit(taker);
+        total += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+    }
+    return total / rounds;
+}
+
+} // namespace
+
+int main() {
+    auto eng = std::make_unique<Engine>();
+    sweep_ns(*eng, 64, 200); // warm the pool and the ladder
+    printf("%8s %14s %12s %12s\n", "depth", "ns/sweep", "ns/level", "ns/maker");
+    for (uint32_t depth : {1u, 4u, 16u, 64u, 256u, 1024u}) {
+        const uint32_t rounds = 200000 / depth > 20 ? 200000 / depth : 20;
+        const double ns = sweep_ns(*eng, depth, rounds);
+        printf("%8u %14.1f %12.1f %12.2f\n", depth, ns, ns / LEVELS, ns / (LEVELS * depth));
+    }
+    return 0;
+}
@@ -46,24 +46,29 @@ class alignas(CACHE_LINE_SIZE) AtomicRingBuffer
     };
 
 public:
-    explicit AtomicRingBuffer(size_t size)
+    // With 'defer_init' the cells are left untouched until initialise(), so the thread that
+    // owns the ring can write them (and take the first touch of their pages) in parallel with
+    // the other rings instead of the constructing thread doing all of them serially.
+    explicit AtomicRingBuffer(size_t size, bool defer_init = false)
         : capacity_(nextPowerOf2(size)), mask_(capacity_ - 1),
           buffer_(nullptr), head_(0), tail_(0)
     {
         assert((capacity_ & (capacity_ - 1)) == 0);
         buffer_ = static_cast<Cell *>(aligned_alloc_portable(CACHE_LINE_SIZE, sizeof(Cell) * capacity_));
         assert(buffer_ != nullptr);
-        for (size_t i = 0; i < capacity_; ++i)
-        {
-            new (&buffer_[i]) Cell();
-            buffer_[i].seq.store(i, std::memory_order_relaxed);
-        }
+        if (!defer_init)
+            initialise();
     }
 
     ~AtomicRingBuffer()
     {
         if (buffer_)
         {
+            if (!ready())
+            {
+                aligned_free_portable(buffer_);
+                return;
+            }
             for (size_t i = 0; i < capacity_; ++i)
             {
                 buffer_[i].~Cell();
@@ -75,6 +80,20 @@ public:
     AtomicRingBuffer(const AtomicRingBuffer &) = delete;
     AtomicRingBuffer &operator=(const AtomicRingBuffer &) = delete;
 
+    // Construct every cell. Call once, before any push/pop, on a deferred ring.
+    void initialise() noexcept
+    {
+        for (size_t i = 0; i < capacity_; ++i)
+        {
+            new (&buffer_[i]) Cell();
+            buffer_[i].seq.store(i, std::memory_order_relaxed);
+        }
+        ready_.store(true, std::memory_order_release);
+    }
+
+    // True once the cells are constructed; producers must not push before
+    bool ready() const noexcept { return ready_.load(std::memory_order_acquire); }
+
     // push single item. returns true if success, false if full.
     bool push(const T &item) noexcept
     {
@@ -142,6 +161,61 @@ public:
         }
     }
 
+    // Zero-copy produce: claim() reserves the next cell and returns its payload, to be written
+    // in place (nullptr if full); commit(ticket) publishes it. Consumers stop at a claimed cell
+    // until it is committed, so commit promptly.
+    T *claim(size_t &ticket) noexcept
+    {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Cell &cell = buffer_[pos & mask_];
+            size_t seq = cell.seq.load(std::memory_order_acquire);
+            intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+            if (dif == 0)
+            {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    ticket = pos;
+                    return &cell.data;
+                }
+            }
+            else if (dif < 0)
+                return nullptr;
+            else
+                pos = tail_.load(std::memory_order_relaxed);
+        }
+    }
+
+    void commit(size_t ticket) noexcept { buffer_[ticket & mask_].seq.store(ticket + 1, std::memory_order_release); }
+
+    // Zero-copy consume: peek() takes the next item and returns it in place (nullptr if empty);
+    // release(ticket) hands the cell back to producers once the item has been used.
+    const T *peek(size_t &ticket) noexcept
+    {
+        size_t pos = head_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Cell &cell = buffer_[pos & mask_];
+            size_t seq = cell.seq.load(std::memory_order_acquire);
+            intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (dif == 0)
+            {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    ticket = pos;
+                    return &cell.data;
+                }
+            }
+            else if (dif < 0)
+                return nullptr;
+            else
+                pos = head_.load(std::memory_order_relaxed);
+        }
+    }
+
+    void release(size_t ticket) noexcept { buffer_[ticket & mask_].seq.store(ticket + capacity_, std::memory_order_release); }
+
     // pushBatch: try to push up to count items. returns number pushed.
     size_t pushBatch(const T *items, size_t count) noexcept
     {
@@ -224,6 +298,8 @@ private:
     const size_t mask_;
     Cell *buffer_;
 
+    std::atomic<bool> ready_{false};
+
     alignas(CACHE_LINE_SIZE) std::atomic<size_t> head_;
     alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail_;
 };
\ No newline at end of file
@@ -5,23 +5,73 @@ struct Config
 {
     // Engine bounds - optimized for performance
     static constexpr uint32_t MAX_TICKS = 32768;    // Reduced from 65536 for better cache locality
-    static constexpr uint32_t MAX_ORDERS = 500'000; // Reduced from 1M for better memory usage
+    // Order pools start with one 64K-order segment and grow on demand up to these ceilings
+    static constexpr uint32_t MAX_ORDERS = 1u << 22;
+
+    // Shared-pool engine groups: per-instrument ladder window and per-worker node pool
+    static constexpr uint32_t GROUP_LADDER_TICKS = 512; // ticks around mid each small book can hold
+    static constexpr uint32_t GROUP_POOL_ORDERS = 1u << 22;
 
     // Ring buffer capacity - MUST be large enough to handle order generation rate
     // Increase ring capacity so generator can push 30M orders without heavy backpressure
     static constexpr size_t RING_CAPACITY = 1 << 25; // 33,554,432 slots (>= 30M)
+    static constexpr size_t CANCEL_LANE_CAPACITY = 1 << 16; // per gateway and worker (see cancel_lane)
 
     // Benchmark knobs - optimized for 30M target
     uint64_t num_orders = 40'000'000; // 30M orders for measurement
     uint32_t span_ticks = 50;         // Reduced from 100 for tighter price clustering
     uint32_t max_qty = 10;            // Reduced from 50 for faster processing
     uint64_t cancel_every = 100000;      // Cancel every 500th order (more reasonable for 30M)
+    uint32_t peg_pct = 0;             // share of adds sent as midpoint/primary pegs
+    uint32_t hidden_pct = 0;          // share of limit adds sent fully hidden
+    uint32_t post_only_pct = 0;       // share of limit adds sent post-only (half of them sliding)
+    uint32_t dark_pct = 0;            // share of adds sent to the dark midpoint book
+    uint32_t min_fill_pct = 0;        // share of limit adds sent all-or-none or with a minimum fill
+    uint32_t mass_quote_every = 0;    // every Nth message is a market maker's mass quote (0 = off)
+    uint32_t mass_quote_size = 32;    // instruments per mass quote
+    uint32_t num_makers = 4;          // market makers taking turns to quote
     unsigned rng_seed = 12;
 
+    // Instruments: symbol-affine routing, instrument i starts on worker i % workers
+    uint32_t num_instruments = 16;
+    uint32_t hot_instrument_pct = 40; // share of flow sent to instrument 0
+    uint32_t queue_position_instruments = 0; // instruments [0, N) keep a queue-position index
+    uint32_t spreads = 0;             // calendar spreads with implied matching (3 instruments each)
+    uint32_t preload_orders = 0;      // resting orders bulk-loaded into each book before the flow starts
+
+    // Layout: producer/consumer pipeline (default) or thread-per-core reactor shards
+    bool reactor = false;
+    bool compare_layouts = false; // run both layouts on the same flow and compare
+    bool shared_pool = false;     // reactor shards host their instruments in one EngineGroup
+    uint32_t gateways = 1;        // pipeline generator threads, each with its own lane into every worker
+    bool sequenced_ingress = false; // workers take messages in global arrival order across gateways
+    bool cancel_lane = false;     // cancels go through a per-worker priority lane drained first
+    uint64_t cold_book_idle_ops = 200'000; // group ops without activity before a book is compacted
+
+    // Live rebalancing of instruments between workers
+    bool rebalance = true;
+    uint32_t rebalance_interval_ms = 20;
+    double rebalance_threshold = 1.5; // busiest / idlest worker load ratio that triggers a move
+
     // Advanced stats toggles for HFT demos
     bool show_latency_percentiles = false; // P50, P95, P99 latency breakdown
     bool show_memory_stats = false;        // Memory allocation and usage stats
     bool show_cache_stats = false;         // Cache performance metrics
     bool show_thread_stats = false;        // Per-thread performance breakdown
     bool show_all_advanced = true;        // Enable all advanced stats
+
+    // Adaptive worker batch sizing: batches grow with ring depth during bursts but are capped so that
+    // the last message in a batch waits at most ~batch_latency_target_ns behind the others
+    uint32_t min_batch = 16;
+    uint32_t max_batch = 10'000;
+    uint64_t batch_latency_target_ns = 50'000;
+
+    // Per-batch time a worker may spend compacting its books' busiest levels (0 = off)
+    uint64_t compact_budget_ns = 2'000;
+
+    // Stamp 1 in N messages for per-stage latency breakdown (0 = off)
+    uint32_t latency_sample_every = 1024;
+
+    // Chrome trace output (only used when built with ORDERBOOK_TRACE)
+    const char *trace_path = "orderbook_trace.json";
 };
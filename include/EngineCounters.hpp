@@ -0,0 +1,118 @@
+#pragma once
+// Optional engine work counters, reported as per-thread log2 histograms: what the matching
+// code did for each order, to explain the slow ones.
+//
+// Build with -DORDERBOOK_ENGINE_COUNTERS=ON to enable. When disabled every ENGINE_* macro
+// expands to nothing, so the engine compiles exactly as before.
+#include <cstdint>
+
+enum class EngineCounter : uint8_t
+{
+    LevelsCrossed = 0, // price levels (and peg queues) one aggressive order traded at
+    MakersVisited,     // resting orders one aggressive order filled or passed over
+    WordsScanned,      // bitset words read by one next_ask_from / prev_bid_from
+    HandleProbes,      // handle slots tried by one assign_handle
+    FreeListDepth,     // free nodes left after one allocation
+    COUNT
+};
+
+#ifdef ORDERBOOK_ENGINE_COUNTERS
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Stats.hpp" // Log2Histogram
+
+class EngineCounters
+{
+public:
+    // Per-thread histograms. Only the owning thread writes; report() reads after join.
+    struct Thread
+    {
+        Log2Histogram hist[(size_t)EngineCounter::COUNT];
+        uint64_t pending[2]{}; // LevelsCrossed, MakersVisited of the order being matched
+        std::string name;
+    };
+
+    static EngineCounters &instance()
+    {
+        static EngineCounters c;
+        return c;
+    }
+
+    static inline Thread &local()
+    {
+        Thread *t = tls_;
+        if (__builtin_expect(t == nullptr, 0))
+            t = instance().attach();
+        return *t;
+    }
+
+    // One observation of a per-call counter
+    static inline void sample(EngineCounter c, uint64_t v) { local().hist[(size_t)c].record(v); }
+
+    // Add to a per-order counter; end_order() turns the totals into one observation each
+    static inline void tally(EngineCounter c, uint64_t n) { local().pending[(size_t)c] += n; }
+
+    static inline void end_order()
+    {
+        Thread &t = local();
+        if (t.pending[0] == 0)
+            return; // did not cross: not an aggressive order
+        t.hist[(size_t)EngineCounter::LevelsCrossed].record(t.pending[0]);
+        t.hist[(size_t)EngineCounter::MakersVisited].record(t.pending[1]);
+        t.pending[0] = t.pending[1] = 0;
+    }
+
+    static void set_thread_name(const std::string &name) { local().name = name; }
+
+    // Print every thread's histograms. Call after all engine threads have joined.
+    void report()
+    {
+        std::scoped_lock lock(mu_);
+        static const char *names[] = {"levels/order", "makers/order", "words/scan", "handle probes", "free nodes"};
+        printf("\nEngine counters\n");
+        for (const auto &t : threads_)
+        {
+            printf("  %s\n", t->name.empty() ? "thread" : t->name.c_str());
+            printf("    %-14s %10s %8s %8s %8s %8s\n", "", "n", "Mean", "P50", "P99", "Max");
+            for (size_t c = 0; c < (size_t)EngineCounter::COUNT; ++c)
+            {
+                const Log2Histogram &h = t->hist[c];
+                if (h.count == 0)
+                    continue;
+                printf("    %-14s %10llu %8.2f %8llu %8llu %8llu\n", names[c], (unsigned long long)h.count,
+                       (double)h.sum / h.count, (unsigned long long)h.percentile(50),
+                       (unsigned long long)h.percentile(99), (unsigned long long)h.max);
+            }
+        }
+    }
+
+private:
+    Thread *attach()
+    {
+        std::scoped_lock lock(mu_);
+        threads_.push_back(std::make_unique<Thread>());
+        tls_ = threads_.back().get();
+        return tls_;
+    }
+
+    std::mutex mu_;
+    std::vector<std::unique_ptr<Thread>> threads_;
+    static inline thread_local Thread *tls_ = nullptr;
+};
+
+#define ENGINE_SAMPLE(c, v) EngineCounters::sample(EngineCounter::c, (uint64_t)(v))
+#define ENGINE_TALLY(c, n) EngineCounters::tally(EngineCounter::c, (uint64_t)(n))
+#define ENGINE_END_ORDER() EngineCounters::end_order()
+#define ENGINE_COUNTERS_THREAD(name) EngineCounters::set_thread_name(name)
+
+#else
+
+#define ENGINE_SAMPLE(c, v) ((void)0)
+#define ENGINE_TALLY(c, n) ((void)0)
+#define ENGINE_END_ORDER() ((void)0)
+#define ENGINE_COUNTERS_THREAD(name) ((void)0)
+
+#endif
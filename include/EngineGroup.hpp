@@ -0,0 +1,186 @@
+// EngineGroup.hpp
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+#include <memory>
+#include <vector>
+#include "OrderPool.hpp"
+#include "PriceLadder.hpp"
+
+// Many small books on one worker sharing a single order pool and handle space.
+// Each book keeps only its own LADDER_TICKS-wide ladder and bitsets (a few KB), anchored at a
+// base tick, so thousands of instruments fit where one full MatchingEngine used to.
+//
+// Ladders are materialised lazily: a book starts cold, holding only a compact Image of its
+// occupied levels, and gets a ladder from the spare list on first activity. evict_idle()
+// compacts books that have seen no activity for a while, returning their ladders, so only
+// the hot books occupy ladder memory (and cache).
+template <uint32_t LADDER_TICKS, uint32_t POOL_ORDERS>
+class EngineGroup {
+public:
+    using Pool   = OrderPool<POOL_ORDERS>;
+    using Ladder = PriceLadder<LADDER_TICKS, Pool>;
+
+    static constexpr uint32_t NIL      = Ladder::NIL;
+    static constexpr uint32_t NO_PRICE = Ladder::NO_PRICE;
+    static constexpr uint32_t DONE_FILL= Ladder::DONE_FILL;
+    static constexpr uint32_t MAX_BOOKS = 1u << 16; // OrderNode::book is 16 bits
+
+    // 'base_tick' is the absolute tick of ladder slot 0 for every book
+    EngineGroup(uint32_t num_books, uint32_t base_tick)
+        : pool_(std::make_unique<Pool>()), live_(num_books, nullptr), cold_(num_books),
+          last_used_(num_books, 0), base_(num_books, base_tick)
+    {
+        assert(num_books <= MAX_BOOKS);
+    }
+
+    uint32_t num_books() const { return (uint32_t)live_.size(); }
+
+    // Per-book footprint of a materialised ladder, excluding the shared pool
+    static constexpr size_t book_bytes() { return sizeof(Ladder); }
+
+    // Add a limit order to 'book'. Prices outside the book's ladder window are rejected.
+    // Pegged orders carry no price and go straight to the ladder.
+    inline uint32_t add_limit(uint32_t book, const OrderIn& in) {
+        if (unlikely(in.peg != PEG_NONE)) return ladder(book).add_limit(in);
+        const uint32_t rel = in.price_tick - base_[book]; // wraps for ticks below base
+        if (unlikely(rel >= LADDER_TICKS)) return NIL;
+        OrderIn local = in;
+        local.price_tick = rel;
+        return ladder(book).add_limit(local);
+    }
+
+    // Cancel by handle; handles are unique across the whole group
+    inline bool cancel(uint32_t handle) {
+        uint32_t idx = pool_->lookup(handle);
+        if (idx == NIL) return false;
+        ladder(pool_->node(idx).book).cancel_node(idx);
+        return true;
+    }
+
+    // Move a quote on 'book' to (tick, qty); see MatchingEngine::requote. A handle resting on
+    // another book is rejected (NIL), leaving that order untouched.
+    inline uint32_t requote(uint32_t book, uint32_t handle, uint8_t side, uint32_t tick, uint32_t qty) {
+        const uint32_t idx = handle == NIL ? NIL : pool_->lookup(handle);
+        if (idx != NIL) {
+            if (unlikely(pool_->node(idx).book != book)) return NIL;
+            Ladder& l = ladder(book);
+            if (qty != 0 && l.amend_in_place(idx, tick - base_[book], qty)) return handle;
+            l.cancel_node(idx);
+        }
+        if (qty == 0) return NIL;
+        OrderIn in{.client_id=0,.price_tick=tick,.qty=qty,.side=side,.flags=0};
+        return add_limit(book, in);
+    }
+
+    // Queries never materialise a cold book
+    inline uint32_t best_bid(uint32_t book) const {
+        return to_abs(book, live_[book] ? live_[book]->best_bid() : cold_[book].best_bid);
+    }
+    inline uint32_t best_ask(uint32_t book) const {
+        return to_abs(book, live_[book] ? live_[book]->best_ask() : cold_[book].best_ask);
+    }
+    inline uint64_t total_trades(uint32_t book) const { return live_[book] ? live_[book]->total_trades() : cold_[book].trades; }
+    inline uint64_t total_volume(uint32_t book) const { return live_[book] ? live_[book]->total_volume() : cold_[book].volume; }
+    inline uint64_t dark_trades(uint32_t book) const { return live_[book] ? live_[book]->dark_trades() : cold_[book].dark_trades; }
+    inline uint64_t dark_volume(uint32_t book) const { return live_[book] ? live_[book]->dark_volume() : cold_[book].dark_volume; }
+    inline uint64_t state_hash(uint32_t book) const { return live_[book] ? live_[book]->state_hash() : cold_[book].hash; }
+
+    // Volume-at-price summary of 'book' over absolute ticks [lo, hi); a cold book is summed
+    // from the traded ticks kept in its image
+    using VolumeSummary = typename Ladder::Profile::Summary;
+    VolumeSummary volume_summary(uint32_t book, uint32_t lo, uint32_t hi) const {
+        const uint32_t base = base_[book];
+        const uint32_t rlo = lo > base ? lo - base : 0, rhi = hi > base ? hi - base : 0;
+        VolumeSummary s;
+        if (live_[book]) s = live_[book]->profile().summary(rlo, rhi);
+        else for (const auto& v : cold_[book].profile) {
+            if (v.tick < rlo || v.tick >= rhi) continue;
+            s.volume += v.volume;
+            s.trades += v.trades;
+            if (v.volume > s.poc_volume) { s.poc = v.tick; s.poc_volume = v.volume; }
+        }
+        if (s.poc != ~0u) s.poc += base;
+        return s;
+    }
+
+    // Compact every materialised book untouched for more than 'idle_ops' group operations.
+    // Returns the number of books evicted.
+    uint32_t evict_idle(uint64_t idle_ops) {
+        uint32_t evicted = 0;
+        for (uint32_t b = 0; b < live_.size(); ++b) {
+            if (!live_[b] || clock_ - last_used_[b] <= idle_ops) continue;
+            live_[b]->save(cold_[b]);
+            spare_.push_back(live_[b]);
+            live_[b] = nullptr;
+            ++evicted;
+        }
+        live_count_ -= evicted;
+        evictions_ += evicted;
+        return evicted;
+    }
+
+    // Add a pool segment if free nodes are running low. Call between batches.
+    inline bool grow_if_low() { return pool_->grow_if_low(); }
+    uint32_t pool_capacity() const { return pool_->capacity(); }
+
+    uint32_t live_books() const { return live_count_; }
+    uint64_t materialisations() const { return materialisations_; }
+    uint64_t evictions() const { return evictions_; }
+    size_t ladders_allocated() const { return slab_.size(); }
+
+    // Engine-shaped view of one book (add_limit/cancel/requote), for code written against MatchingEngine
+    class BookRef {
+    public:
+        BookRef(EngineGroup& g, uint32_t book) : g_(&g), book_(book) {}
+        inline uint32_t add_limit(const OrderIn& in) { return g_->add_limit(book_, in); }
+        inline bool cancel(uint32_t handle) { return g_->cancel(handle); }
+        inline uint32_t requote(uint32_t handle, uint8_t side, uint32_t tick, uint32_t qty) {
+            return g_->requote(book_, handle, side, tick, qty);
+        }
+        inline uint32_t best_bid() const { return g_->best_bid(book_); }
+        inline uint32_t best_ask() const { return g_->best_ask(book_); }
+    private:
+        EngineGroup* g_;
+        uint32_t book_;
+    };
+    BookRef book(uint32_t b) { return BookRef(*this, b); }
+
+private:
+    using Image = typename Ladder::Image;
+
+    std::unique_ptr<Pool> pool_;  // shared order nodes & handle table
+    std::vector<Ladder*> live_;   // materialised ladder per book (nullptr while cold)
+    std::vector<Image> cold_;     // compact form of cold books
+    std::vector<uint64_t> last_used_; // clock_ at each book's last activity
+    std::vector<uint32_t> base_;  // absolute tick of each ladder's slot 0
+
+    std::vector<std::unique_ptr<Ladder>> slab_; // every ladder ever allocated
+    std::vector<Ladder*> spare_;                // ladders returned by evicted books
+    uint64_t clock_{0};
+    uint32_t live_count_{0};
+    uint64_t materialisations_{0};
+    uint64_t evictions_{0};
+
+    inline Ladder& ladder(uint32_t book) {
+        last_used_[book] = ++clock_;
+        Ladder* l = live_[book];
+        if (likely(l != nullptr)) return *l;
+        return materialise(book);
+    }
+
+    Ladder& materialise(uint32_t book) {
+        Ladder* l;
+        if (!spare_.empty()) { l = spare_.back(); spare_.pop_back(); }
+        else { slab_.push_back(std::make_unique<Ladder>()); l = slab_.back().get(); }
+        l->attach(pool_.get(), (uint16_t)book);
+        l->restore(cold_[book]);
+        live_[book] = l;
+        ++live_count_;
+        ++materialisations_;
+        return *l;
+    }
+
+    inline uint32_t to_abs(uint32_t book, uint32_t rel) const { return rel == NO_PRICE ? NO_PRICE : rel + base_[book]; }
+};
@@ -0,0 +1,216 @@
+// ImpliedSpread.hpp
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include "PriceLadder.hpp"
+
+// Implied matching between a calendar spread and its two outright legs, all matched by the
+// same thread. The spread trades front minus back: buying one spread buys the front and sells
+// the back, at spread tick CENTER + front - back.
+//
+// Implied-in: the legs' tops imply spread prices (spread bid = front bid - back ask, ...).
+// Implied-out: the spread and one leg imply prices in the other leg (front ask = spread ask
+// + back ask, ...). The six implied prices are recomputed only when a top-of-book price or
+// size changes, which is checked in O(1) after every operation on the three books.
+//
+// An incoming limit order that crosses an implied price strictly better than its own book's
+// opposite touch trades against it first: both contributing top levels are hit with IOC
+// orders for the same quantity, in the same pass, so the three books never show a cross.
+// Displayed liquidity at an equal price keeps priority. Pegs, post-only, FOK and minimum-fill
+// orders match against their own book only (post-only is rejected if it would cross an
+// implied price). Implied sizes count only top-of-book makers without a minimum fill.
+//
+// Every book counts its side of an implied trade in its own trades, volume and profile; the
+// implied_* totals count each implied trade once more, on its own.
+template <typename Eng>
+class ImpliedSpread {
+public:
+    enum Leg : uint8_t { FRONT = 0, BACK = 1, SPREAD = 2 };
+
+    static constexpr uint32_t NIL      = Eng::NIL;
+    static constexpr uint32_t NO_PRICE = Eng::NO_PRICE;
+    static constexpr uint32_t DONE_FILL= Eng::DONE_FILL;
+
+    // 'max_ticks' bounds every book's ticks; 'center' is the spread tick of front == back
+    ImpliedSpread(Eng& front, Eng& back, Eng& spread, uint32_t center, uint32_t max_ticks)
+        : books_{&front, &back, &spread}, center_(center), max_ticks_(max_ticks) {
+        for (uint8_t l = 0; l < 3; ++l) refresh(l);
+    }
+
+    // Add a limit order to one of the three books, taking implied liquidity first
+    inline uint32_t add_limit(uint8_t leg, const OrderIn& in) {
+        Eng& own = *books_[leg];
+        if (unlikely(in.peg != PEG_NONE || in.min_qty != 0 || (in.flags & (ORDER_FOK | ORDER_AON))))
+            return finish(leg, own.add_limit(in));
+
+        const uint8_t opp = in.side ^ 1;
+        if (unlikely(in.flags & (ORDER_POST_ONLY | ORDER_POST_SLIDE))) {
+            if (crosses(in.side, in.price_tick, implied_[leg][opp].tick)) return NIL;
+            return finish(leg, own.add_limit(in));
+        }
+
+        uint32_t remaining = in.qty;
+        while (remaining != 0) {
+            const Implied& im = implied_[leg][opp];
+            if (im.tick == NO_PRICE || im.qty == 0 || !crosses(in.side, in.price_tick, im.tick)) break;
+            // own touch, if any of it is free to trade with an order of any size
+            const Top& top = top_[leg];
+            const uint32_t direct = opp == SIDE_BUY ? (top.bid_qty ? top.bid : NO_PRICE) : (top.ask_qty ? top.ask : NO_PRICE);
+            if (direct != NO_PRICE && !better(opp, im.tick, direct)) {
+                // own book first, down to the implied price, then look again
+                OrderIn ioc{.client_id=in.client_id,.price_tick=im.tick,.qty=remaining,.side=in.side,.flags=ORDER_IOC};
+                const uint64_t vol = own.total_volume();
+                own.add_limit(ioc);
+                const uint32_t traded = (uint32_t)(own.total_volume() - vol);
+                remaining -= traded;
+                refresh(leg);
+                if (traded != 0) continue;
+                // only makers this order is too small for: the implied price is next
+            }
+            const uint32_t q = remaining < im.qty ? remaining : im.qty;
+            execute(leg, im, q);
+            remaining -= q;
+        }
+        if (remaining == 0) return DONE_FILL;
+
+        OrderIn rest = in;
+        rest.qty = remaining;
+        return finish(leg, own.add_limit(rest));
+    }
+
+    inline bool cancel(uint8_t leg, uint32_t handle) {
+        const bool ok = books_[leg]->cancel(handle);
+        if (ok) refresh(leg);
+        return ok;
+    }
+
+    // Same contract as MatchingEngine::requote; a new price goes through add_limit
+    inline uint32_t requote(uint8_t leg, uint32_t handle, uint8_t side, uint32_t tick, uint32_t qty) {
+        Eng& own = *books_[leg];
+        if (handle != NIL) {
+            if (own.amend(handle, tick, qty)) { refresh(leg); return handle; }
+            if (own.cancel(handle)) refresh(leg);
+        }
+        if (qty == 0) return NIL;
+        OrderIn in{.client_id=0,.price_tick=tick,.qty=qty,.side=side,.flags=0};
+        return add_limit(leg, in);
+    }
+
+    // Implied price currently offered on (leg, side), NO_PRICE if none
+    inline uint32_t implied_price(uint8_t leg, uint8_t side) const { return implied_[leg][side].tick; }
+
+    inline uint64_t implied_trades() const { return implied_trades_; }
+    inline uint64_t implied_volume() const { return implied_volume_; }
+    inline uint64_t recomputes() const { return recomputes_; }
+
+    // Engine-shaped view of one of the three books, for code written against MatchingEngine
+    class LegRef {
+    public:
+        LegRef(ImpliedSpread& s, uint8_t leg) : s_(&s), leg_(leg) {}
+        inline uint32_t add_limit(const OrderIn& in) { return s_->add_limit(leg_, in); }
+        inline bool cancel(uint32_t handle) { return s_->cancel(leg_, handle); }
+        inline uint32_t requote(uint32_t handle, uint8_t side, uint32_t tick, uint32_t qty) {
+            return s_->requote(leg_, handle, side, tick, qty);
+        }
+        inline uint32_t best_bid() const { return s_->books_[leg_]->best_bid(); }
+        inline uint32_t best_ask() const { return s_->books_[leg_]->best_ask(); }
+    private:
+        ImpliedSpread* s_;
+        uint8_t leg_;
+    };
+    LegRef leg(uint8_t l) { return LegRef(*this, l); }
+
+private:
+    struct Top {
+        uint32_t bid{NO_PRICE}, ask{NO_PRICE};
+        uint32_t bid_qty{0}, ask_qty{0};
+        bool operator==(const Top&) const = default;
+    };
+    // One IOC that realises half of an implied price
+    struct Hit {
+        uint8_t leg;
+        uint8_t side;
+        uint32_t tick;
+    };
+    // Implied liquidity resting on one side of one book, built from two other tops
+    struct Implied {
+        uint32_t tick{NO_PRICE};
+        uint32_t qty{0};
+        Hit hits[2];
+    };
+
+    Eng* books_[3];
+    uint32_t center_;
+    uint32_t max_ticks_;
+    Top top_[3];
+    Implied implied_[3][2]; // [leg][side of the implied liquidity]
+    uint64_t implied_trades_{0};
+    uint64_t implied_volume_{0};
+    uint64_t recomputes_{0};
+
+    inline uint32_t finish(uint8_t leg, uint32_t r) { refresh(leg); return r; }
+
+    // Would an order on 'side' at 'limit' trade at 'tick'?
+    static inline bool crosses(uint8_t side, uint32_t limit, uint32_t tick) {
+        return tick != NO_PRICE && (side == SIDE_BUY ? tick <= limit : tick >= limit);
+    }
+    // Is resting price 'a' strictly better than 'b' for liquidity on 'side'?
+    static inline bool better(uint8_t side, uint32_t a, uint32_t b) { return side == SIDE_BUY ? a > b : a < b; }
+
+    // Re-read one book's top; recompute implied prices only if it moved
+    inline void refresh(uint8_t leg) {
+        const Eng& b = *books_[leg];
+        const Top t{b.best_bid(), b.best_ask(), b.best_bid_free_qty(), b.best_ask_free_qty()};
+        if (likely(t == top_[leg])) return;
+        top_[leg] = t;
+        recompute();
+    }
+
+    // Hit both contributing tops for 'q' (<= both displayed sizes, so each IOC fills fully) and
+    // record the incoming order's fill at the implied price in its own book
+    inline void execute(uint8_t leg, const Implied& im, uint32_t q) {
+        const uint8_t a = im.hits[0].leg, b = im.hits[1].leg; // 'im' is recomputed by refresh
+        books_[leg]->record_fill(im.tick, q);
+        for (const Hit& h : im.hits) {
+            OrderIn ioc{.client_id=0,.price_tick=h.tick,.qty=q,.side=h.side,.flags=ORDER_IOC};
+            books_[h.leg]->add_limit(ioc);
+        }
+        ++implied_trades_;
+        implied_volume_ += q;
+        refresh(a);
+        refresh(b);
+    }
+
+    // Store an implied price built from two tops, if both exist and the price is on the ladder
+    inline void set(Implied& im, int64_t price, uint32_t qa, uint32_t qb, Hit ha, Hit hb) {
+        im.tick = NO_PRICE;
+        if (ha.tick == NO_PRICE || hb.tick == NO_PRICE || price < 0 || price >= (int64_t)max_ticks_) return;
+        im.tick = (uint32_t)price;
+        im.qty = qa < qb ? qa : qb;
+        im.hits[0] = ha;
+        im.hits[1] = hb;
+    }
+
+    void recompute() {
+        ++recomputes_;
+        const Top& f = top_[FRONT];
+        const Top& k = top_[BACK];
+        const Top& s = top_[SPREAD];
+        const int64_t c = center_;
+        // implied-out, front: sell spread + sell back / buy spread + buy back
+        set(implied_[FRONT][SIDE_BUY], (int64_t)s.bid + k.bid - c, s.bid_qty, k.bid_qty,
+            {SPREAD, SIDE_SELL, s.bid}, {BACK, SIDE_SELL, k.bid});
+        set(implied_[FRONT][SIDE_SELL], (int64_t)s.ask + k.ask - c, s.ask_qty, k.ask_qty,
+            {SPREAD, SIDE_BUY, s.ask}, {BACK, SIDE_BUY, k.ask});
+        // implied-out, back: buy spread + sell front / sell spread + buy front
+        set(implied_[BACK][SIDE_BUY], (int64_t)f.bid - s.ask + c, f.bid_qty, s.ask_qty,
+            {FRONT, SIDE_SELL, f.bid}, {SPREAD, SIDE_BUY, s.ask});
+        set(implied_[BACK][SIDE_SELL], (int64_t)f.ask - s.bid + c, f.ask_qty, s.bid_qty,
+            {FRONT, SIDE_BUY, f.ask}, {SPREAD, SIDE_SELL, s.bid});
+        // implied-in, spread: sell front + buy back / buy front + sell back
+        set(implied_[SPREAD][SIDE_BUY], (int64_t)f.bid - k.ask + c, f.bid_qty, k.ask_qty,
+            {FRONT, SIDE_SELL, f.bid}, {BACK, SIDE_BUY, k.ask});
+        set(implied_[SPREAD][SIDE_SELL], (int64_t)f.ask - k.bid + c, f.ask_qty, k.bid_qty,
+            {FRONT, SIDE_BUY, f.ask}, {BACK, SIDE_SELL, k.bid});
+    }
+};
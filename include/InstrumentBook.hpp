@@ -0,0 +1,410 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "AtomicRingBuffer.hpp" // CACHE_LINE_SIZE
+#include "Config.hpp"
+#include "MatchingEngine.hpp"
+#include "EngineGroup.hpp"
+#include "ImpliedSpread.hpp"
+#include "OrderMsg.hpp"
+
+using Engine = MatchingEngine<Config::MAX_TICKS, Config::MAX_ORDERS>;
+using GroupEngine = EngineGroup<Config::GROUP_LADDER_TICKS, Config::GROUP_POOL_ORDERS>;
+using Spread = ImpliedSpread<Engine>;
+
+// Thread-local outcome counters, flushed into Stats periodically
+struct MatchCounters
+{
+    uint64_t popped = 0;
+    uint64_t donefill = 0;
+    uint64_t cancels = 0;
+    uint64_t rejected = 0;
+    uint64_t quote_acks = 0;    // mass quotes fully applied
+    uint64_t quote_sides = 0;   // quote sides updated (placed, moved or pulled)
+    uint64_t quote_amends = 0;  // of which amended in place, keeping priority
+};
+
+// client order id -> engine handle, plus the reverse tag so a stale entry (order already
+// filled and its handle reused) is never cancelled by mistake. Covers one handle space,
+// which may be a single engine's or a whole EngineGroup's, and grows with the pool.
+struct HandleTracker
+{
+    explicit HandleTracker(uint32_t initial_handles = 1u << 16) : handle_owner(initial_handles, 0) {}
+
+    std::unordered_map<uint32_t, uint32_t> handles;
+    std::vector<uint64_t> handle_owner;
+
+    inline void track(uint64_t client_id, uint32_t handle)
+    {
+        claim(handle, client_id);
+        handles[(uint32_t)client_id] = handle;
+    }
+
+    // Tag 'handle' with its new owner without a client id entry (used for quotes)
+    inline void claim(uint32_t handle, uint64_t owner)
+    {
+        if (unlikely(handle >= handle_owner.size()))
+            handle_owner.resize(std::max<size_t>(handle + 1, handle_owner.size() * 2), 0);
+        // the previous holder of this handle is gone (filled or cancelled): drop its entry
+        const uint64_t prev = handle_owner[handle];
+        if (prev)
+        {
+            auto it = handles.find((uint32_t)prev);
+            if (it != handles.end() && it->second == handle)
+                handles.erase(it);
+        }
+        handle_owner[handle] = owner;
+    }
+
+    inline uint64_t owner(uint32_t handle) const { return handle < handle_owner.size() ? handle_owner[handle] : 0; }
+
+    // Cancel by client order id. Returns true if a resting order was removed.
+    template <typename Eng>
+    inline bool cancel(Eng &engine, uint32_t client_id)
+    {
+        auto it = handles.find(client_id);
+        if (it == handles.end())
+            return false;
+        const uint32_t handle = it->second;
+        handles.erase(it);
+        if ((uint32_t)handle_owner[handle] != client_id)
+            return false;
+        handle_owner[handle] = 0;
+        return engine.cancel(handle);
+    }
+};
+
+// Match one add/cancel message against any engine-shaped book (MatchingEngine or EngineGroup::BookRef)
+template <typename Eng>
+inline void applyMessage(Eng &engine, HandleTracker &tracker, const OrderMsg &msg, MatchCounters &c)
+{
+    c.popped++;
+    if (msg.msg_type == MessageType::ADD_ORDER)
+    {
+        const uint32_t handle = engine.add_limit(msg);
+        if (handle == Engine::DONE_FILL)
+            c.donefill++;
+        else if (handle == Engine::NIL)
+            c.rejected++;
+        else
+            tracker.track(msg.client_id, handle); // rests in book - track for potential cancellation
+    }
+    else if (msg.msg_type == MessageType::CANCEL_ORDER)
+    {
+        // If order not found, it was already filled - that's ok
+        if (tracker.cancel(engine, msg.handle_to_cancel))
+            c.cancels++;
+    }
+}
+
+// A maker's resting quote on one book: engine handles, NIL while a side is not quoted
+struct QuoteSlot
+{
+    uint32_t bid = Engine::NIL;
+    uint32_t ask = Engine::NIL;
+};
+
+// Owner tag of a quote handle in HandleTracker. Bit 63 keeps it apart from client ids and the
+// low 32 bits stay zero so HandleTracker::cancel never takes it for a client's order.
+inline uint64_t quoteTag(uint32_t maker, uint32_t book, uint8_t side)
+{
+    return (1ull << 63) | ((uint64_t)side << 62) | ((uint64_t)(maker & 0x3FFF) << 48) | ((uint64_t)(book & 0xFFFF) << 32);
+}
+
+// Owner tag of a bulk-loaded order: bit 62 without bit 63 keeps it apart from client ids and
+// quote tags; like a quote tag its low 32 bits are zero.
+inline uint64_t preloadTag(uint32_t book)
+{
+    return (1ull << 62) | ((uint64_t)(book & 0xFFFF) << 32);
+}
+
+// Move one side of a maker's quote. 'handle' is the side's slot; a handle whose tag changed
+// was filled (and possibly reused) since, so the side is simply placed again.
+template <typename Eng>
+inline void requoteSide(Eng &engine, HandleTracker &tracker, uint32_t &handle, uint64_t tag,
+                        uint8_t side, uint32_t tick, uint32_t qty, MatchCounters &c)
+{
+    const uint32_t held = (handle != Engine::NIL && tracker.owner(handle) == tag) ? handle : Engine::NIL;
+    const uint32_t h = engine.requote(held, side, tick, qty);
+    c.quote_sides++;
+    if (h == held && h != Engine::NIL)
+        c.quote_amends++;
+    else if (h == Engine::DONE_FILL)
+        c.donefill++;
+    else if (h != Engine::NIL)
+        tracker.claim(h, tag);
+    else if (qty != 0)
+        c.rejected++;
+    handle = (h == Engine::DONE_FILL) ? Engine::NIL : h;
+}
+
+// Apply one mass-quote entry to a book: both sides replace the maker's previous quote
+template <typename Eng>
+inline void applyQuote(Eng &engine, HandleTracker &tracker, QuoteSlot &slot, uint32_t maker, uint32_t book,
+                       const QuoteEntry &e, MatchCounters &c)
+{
+    requoteSide(engine, tracker, slot.bid, quoteTag(maker, book, SIDE_BUY), SIDE_BUY, e.bid_tick, e.bid_qty, c);
+    requoteSide(engine, tracker, slot.ask, quoteTag(maker, book, SIDE_SELL), SIDE_SELL, e.ask_tick, e.ask_qty, c);
+}
+
+// Everything a worker needs to match one instrument. Owned by exactly one worker at a time;
+// ownership moves between workers through InstrumentDirectory.
+struct InstrumentBook
+{
+    explicit InstrumentBook(uint32_t instrument)
+        : id(instrument) {}
+
+    uint32_t id;
+    Engine engine;
+    HandleTracker tracker;
+    std::vector<QuoteSlot> quotes; // by maker
+    Spread *implied = nullptr;     // set if this book is a leg of a calendar spread (or the spread)
+    uint8_t implied_leg = 0;
+
+    // Priority cancel lane (see MatchingWorker::process): client id of the last add applied, and
+    // cancels that overtook the add they target, applied right after it. Moves with the book.
+    uint64_t last_add = 0;
+    std::vector<OrderMsg> held_cancels;
+
+    // Offered load: written only by the generator, read by the rebalance controller
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> routed{0};
+    // Set by the worker that adopts the book
+    alignas(CACHE_LINE_SIZE) std::atomic<int32_t> owner_worker{-1};
+
+    inline void apply(const OrderMsg &msg, MatchCounters &c)
+    {
+        if (unlikely(implied != nullptr))
+        {
+            auto ref = implied->leg(implied_leg);
+            applyMessage(ref, tracker, msg, c);
+        }
+        else
+            applyMessage(engine, tracker, msg, c);
+    }
+
+    // Bulk-load resting orders into the empty book (see PriceLadder::load), tagging each
+    // handle with its owner. Call before the book is linked to a spread or sees any flow.
+    bool load(const BulkOrders &orders)
+    {
+        std::vector<uint32_t> handles(orders.count);
+        if (!engine.load(orders, handles.data()))
+            return false;
+        if (orders.owner)
+            for (size_t i = 0; i < orders.count; ++i)
+                tracker.claim(handles[i], orders.owner[i]);
+        return true;
+    }
+
+    inline void quote(uint32_t maker, const QuoteEntry &e, MatchCounters &c)
+    {
+        if (unlikely(maker >= quotes.size()))
+            quotes.resize(maker + 1);
+        if (unlikely(implied != nullptr))
+        {
+            auto ref = implied->leg(implied_leg);
+            applyQuote(ref, tracker, quotes[maker], maker, 0, e, c);
+        }
+        else
+            applyQuote(engine, tracker, quotes[maker], maker, 0, e, c);
+    }
+};
+
+// Shared table of instrument books plus the handoff slots used to migrate a book
+// from one worker to another.
+//
+// Migration protocol (no reordering for the moving instrument):
+//   1. the controller posts a request (requestMigration)
+//   2. the generator, between two messages, takes it, sends MIGRATE_OUT down the old
+//      worker's ring and flips its routing entry (epoch++)
+//   3. the old worker reaches MIGRATE_OUT after every earlier message for the instrument
+//      (drain barrier) and publishes the book to the new owner
+//   4. the new worker parks messages for the instrument until it adopts the book, then
+//      replays the parked messages before anything newer
+class InstrumentDirectory
+{
+public:
+    // Each worker's home books are built by a thread of their own, in parallel: one engine's
+    // ladder, pool segment and profile are several MB to zero.
+    InstrumentDirectory(uint32_t num_instruments, uint32_t num_workers)
+        : books_(num_instruments), handoff_to_(num_instruments), inbox_(num_workers)
+    {
+        std::vector<std::thread> builders;
+        for (uint32_t w = 0; w < num_workers && w < num_instruments; ++w)
+            builders.emplace_back([this, w, num_instruments, num_workers]
+                                  {
+                for (uint32_t i = w; i < num_instruments; i += num_workers)
+                    books_[i] = std::make_unique<InstrumentBook>(i); });
+        for (auto &t : builders)
+            t.join();
+        for (uint32_t i = 0; i < num_instruments; ++i)
+            handoff_to_[i].store(-1, std::memory_order_relaxed);
+        for (auto &n : inbox_)
+            n.store(0, std::memory_order_relaxed);
+    }
+
+    uint32_t numInstruments() const { return (uint32_t)books_.size(); }
+    uint32_t numWorkers() const { return (uint32_t)inbox_.size(); }
+    InstrumentBook &book(uint32_t instrument) { return *books_[instrument]; }
+
+    // Turn on the queue-position index for instruments [0, count) (before any order flow)
+    void enableQueuePosition(uint32_t count)
+    {
+        for (uint32_t i = 0; i < count && i < books_.size(); ++i)
+            books_[i]->engine.enable_queue_position(true);
+    }
+
+    // Give every book the same deep starting book: 'per_book' orders, bids on the 'levels' ticks
+    // below mid and asks on the 'levels' ticks above, sizes 1..max_qty. Call after
+    // enableQueuePosition and before linkSpreads. Returns the number of orders loaded.
+    uint64_t preload(uint32_t per_book, uint32_t levels, uint32_t max_qty)
+    {
+        const uint32_t mid = Config::MAX_TICKS / 2;
+        levels = std::clamp<uint32_t>(levels, 1, mid - 1);
+        const uint32_t bids = per_book / 2;
+        std::vector<uint8_t> side(per_book);
+        std::vector<uint32_t> tick(per_book), qty(per_book);
+        std::vector<uint64_t> owner(per_book);
+        for (uint32_t i = 0; i < per_book; ++i)
+        {
+            // sorted by side, then tick ascending: bids run up to mid - 1, asks up from mid + 1
+            const bool buy = i < bids;
+            const uint32_t k = buy ? i : i - bids, n = buy ? bids : per_book - bids;
+            side[i] = buy ? SIDE_BUY : SIDE_SELL;
+            tick[i] = (buy ? mid - levels : mid + 1) + (uint32_t)((uint64_t)k * levels / n);
+            qty[i] = 1 + (uint32_t)(((uint64_t)i * 2654435761u >> 16) % std::max(max_qty, 1u));
+        }
+        uint64_t loaded = 0;
+        for (auto &b : books_)
+        {
+            std::fill(owner.begin(), owner.end(), preloadTag(b->id));
+            if (b->load(BulkOrders{side.data(), tick.data(), qty.data(), owner.data(), per_book}))
+                loaded += per_book;
+        }
+        return loaded;
+    }
+
+    // Link 'count' calendar spreads to their legs for implied matching. Spread k uses three
+    // instruments with the same home worker (front, back = front + W, spread = front + 2W for W
+    // workers); linked books are never migrated, so the three stay on one worker.
+    uint32_t linkSpreads(uint32_t count)
+    {
+        const uint32_t w = numWorkers();
+        uint32_t linked = 0;
+        for (; linked < count; ++linked)
+        {
+            const uint32_t front = (linked / w) * 3 * w + linked % w;
+            if (front + 2 * w >= books_.size())
+                break;
+            InstrumentBook *legs[3] = {books_[front].get(), books_[front + w].get(), books_[front + 2 * w].get()};
+            spreads_.push_back(std::make_unique<Spread>(legs[0]->engine, legs[1]->engine, legs[2]->engine,
+                                                        Config::MAX_TICKS / 2, Config::MAX_TICKS));
+            for (uint8_t l = 0; l < 3; ++l)
+            {
+                legs[l]->implied = spreads_.back().get();
+                legs[l]->implied_leg = l;
+            }
+        }
+        return linked;
+    }
+
+    // Implied trades and volume over every linked spread (call once matching has stopped)
+    void impliedTotals(uint64_t &trades, uint64_t &volume) const
+    {
+        trades = volume = 0;
+        for (const auto &s : spreads_)
+        {
+            trades += s->implied_trades();
+            volume += s->implied_volume();
+        }
+    }
+
+    // Dark midpoint trades over every book (call once matching has stopped)
+    uint64_t darkTrades() const
+    {
+        uint64_t trades = 0;
+        for (const auto &b : books_)
+            trades += b->engine.dark_trades();
+        return trades;
+    }
+
+    // Resting-order hash of one instrument's book (see MatchingEngine::state_hash)
+    uint64_t stateHash(uint32_t instrument) const { return books_[instrument]->engine.state_hash(); }
+
+    // Every book's hash folded in instrument order (call once matching has stopped)
+    uint64_t bookHash() const
+    {
+        uint64_t h = 0;
+        for (const auto &b : books_)
+            h = (h ^ b->engine.state_hash()) * 0x100000001B3ull;
+        return h;
+    }
+
+    // Session volume-at-price summary of one instrument over its whole ladder
+    Engine::Profile::Summary volumeSummary(uint32_t instrument) const
+    {
+        return books_[instrument]->engine.profile().summary(0, Config::MAX_TICKS);
+    }
+
+    // Initial static placement
+    static uint32_t homeWorker(uint32_t instrument, uint32_t num_workers) { return instrument % num_workers; }
+
+    // ---- Controller -> generator ----
+    bool requestMigration(uint32_t instrument, uint32_t to)
+    {
+        int64_t none = -1;
+        return request_.compare_exchange_strong(none, ((int64_t)instrument << 32) | to, std::memory_order_release);
+    }
+    bool migrationPending() const { return request_.load(std::memory_order_acquire) != -1; }
+
+    // Generator side: take a pending request, if any, for an instrument routed by 'gateway'
+    // (with several gateways each routes the instruments with instrument % gateways == gateway)
+    inline bool takeMigration(uint32_t &instrument, uint32_t &to, uint32_t gateway = 0, uint32_t gateways = 1)
+    {
+        int64_t r = request_.load(std::memory_order_relaxed);
+        if (likely(r == -1))
+            return false;
+        if ((uint32_t)(r >> 32) % gateways != gateway)
+            return false;
+        if (!request_.compare_exchange_strong(r, -1, std::memory_order_acquire))
+            return false;
+        instrument = (uint32_t)(r >> 32);
+        to = (uint32_t)(r & 0xFFFFFFFF);
+        return true;
+    }
+
+    // ---- Old worker -> new worker ----
+    void publish(uint32_t instrument, uint32_t to)
+    {
+        handoff_to_[instrument].store((int32_t)to, std::memory_order_release);
+        inbox_[to].fetch_add(1, std::memory_order_release);
+    }
+
+    bool hasInbox(uint32_t worker) const { return inbox_[worker].load(std::memory_order_acquire) != 0; }
+
+    // Adopt every book handed to 'worker'; calls fn(book) for each
+    template <typename Fn>
+    void adopt(uint32_t worker, Fn &&fn)
+    {
+        for (uint32_t i = 0; i < handoff_to_.size(); ++i)
+        {
+            if (handoff_to_[i].load(std::memory_order_acquire) != (int32_t)worker)
+                continue;
+            handoff_to_[i].store(-1, std::memory_order_relaxed);
+            inbox_[worker].fetch_sub(1, std::memory_order_relaxed);
+            books_[i]->owner_worker.store((int32_t)worker, std::memory_order_release);
+            fn(*books_[i]);
+        }
+    }
+
+private:
+    std::vector<std::unique_ptr<InstrumentBook>> books_;
+    std::vector<std::unique_ptr<Spread>> spreads_;
+    std::vector<std::atomic<int32_t>> handoff_to_;
+    std::vector<std::atomic<uint32_t>> inbox_;
+    alignas(CACHE_LINE_SIZE) std::atomic<int64_t> request_{-1};
+};
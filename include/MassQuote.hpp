@@ -0,0 +1,30 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// One instrument's two-sided quote inside a mass quote. A side with qty 0 is pulled.
+struct QuoteEntry
+{
+    uint32_t instrument = 0;
+    uint32_t bid_tick = 0;
+    uint32_t bid_qty = 0;
+    uint32_t ask_tick = 0;
+    uint32_t ask_qty = 0;
+    uint32_t worker = 0; // worker the entry was routed to (set by whoever dispatches the quote)
+};
+
+// A market maker's quotes across many instruments, replacing its previous quote on each.
+// Allocated once by the sender and shared read-only by every worker that owns one of its
+// instruments; each ring message (and each parked copy) holds a reference, and whoever drops
+// the last one acknowledges the whole quote and frees it.
+struct MassQuote
+{
+    uint32_t maker = 0;
+    std::vector<QuoteEntry> entries;
+    std::atomic<uint32_t> refs{1};
+
+    void retain() { refs.fetch_add(1, std::memory_order_relaxed); }
+    // True for the caller that dropped the last reference
+    bool release() { return refs.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+};
@@ -1,31 +1,83 @@
 #pragma once
-#include "AtomicRingBuffer.hpp"
+#include "MpscLanes.hpp"
 #include "OrderManager.hpp"
 #include "Stats.hpp"
 #include "OrderMsg.hpp"
 #include "MatchingEngine.hpp"
+#include "InstrumentBook.hpp"
 #include "Config.hpp"
 #include <atomic>
+#include <unordered_map>
+#include <vector>
 
 class MatchingWorker {
 public:
-    MatchingWorker(AtomicRingBuffer<OrderMsg>& ring, 
+    MatchingWorker(uint32_t id,
+                   MpscLanes<OrderMsg>& ring,
+                   MpscLanes<OrderMsg>* cancels, // priority lane for cancels (nullptr: none)
                    OrderManager& orderManager, 
                    Stats& stats,
-                   std::atomic<bool>& done_flag);
+                   const Config& cfg,
+                   std::atomic<bool>& done_flag,
+                   InstrumentDirectory& dir);
     
     void operator()(); // thread entry point
-    
-    // Access to engine for stats
-    const MatchingEngine<Config::MAX_TICKS, Config::MAX_ORDERS>& engine() const { return engine_; }
 
 private:
-    AtomicRingBuffer<OrderMsg>& ring_;
+    uint32_t id_;
+    MpscLanes<OrderMsg>& ring_; // one lane per gateway
+    MpscLanes<OrderMsg>* cancels_;
     OrderManager& orderManager_;
     Stats& stats_;
-    MatchingEngine<Config::MAX_TICKS, Config::MAX_ORDERS> engine_;
     std::atomic<bool>& done_;
-    
-    // Batch processing for better throughput
-    static constexpr size_t BATCH_SIZE = 10000; // Increased batch size
+    InstrumentDirectory& dir_;
+
+    // Books this worker currently owns, indexed by instrument (nullptr if owned elsewhere)
+    std::vector<InstrumentBook*> books_;
+    // Messages for instruments migrating in, held until the old owner hands the book over
+    std::unordered_map<uint32_t, std::vector<OrderMsg>> parked_;
+
+    // Books whose pool ran low during the current batch, topped up after it. Filled as messages
+    // are applied, so the batch boundary never scans every owned book.
+    std::vector<InstrumentBook*> low_pools_;
+    inline void noteLowPool(InstrumentBook& book)
+    {
+        if (unlikely(book.engine.pool_low()) && (low_pools_.empty() || low_pools_.back() != &book))
+            low_pools_.push_back(&book);
+    }
+
+    MatchCounters local_;
+    Log2Histogram cancel_ack_; // cancel generated -> applied, ns
+
+    inline void process(const OrderMsg& msg);
+    inline void apply(InstrumentBook& book, const OrderMsg& msg);
+    void drainCancels();
+    void applyMassQuote(const OrderMsg& msg);
+    void adoptHandoffs();
+
+    // Adaptive batch sizing bounds (see Config)
+    uint32_t min_batch_;
+    uint32_t max_batch_;
+    uint64_t batch_latency_target_ns_;
+
+    // Online pool compaction between batches, round-robin over owned books
+    static constexpr uint32_t COMPACT_CHUNK = 64; // nodes moved per book visit
+    uint64_t compact_budget_ticks_;
+    size_t compact_next_ = 0;
+    void compactBooks();
+
+    // Pick the next pop size from ring depth and the measured per-message cost
+    inline size_t nextBatchSize(size_t cur, size_t depth, double ns_per_msg) const
+    {
+        size_t cap = max_batch_;
+        if (ns_per_msg > 0.0)
+        {
+            const double by_latency = (double)batch_latency_target_ns_ / ns_per_msg;
+            if (by_latency < (double)cap)
+                cap = by_latency < (double)min_batch_ ? min_batch_ : (size_t)by_latency;
+        }
+        size_t target = depth < min_batch_ ? min_batch_ : (depth > cap ? cap : depth);
+        // grow geometrically during bursts, drop straight back when the ring drains
+        return target > cur ? (cur * 2 < target ? cur * 2 : target) : target;
+    }
 };
@@ -0,0 +1,154 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "AtomicRingBuffer.hpp"
+
+// Multi-producer, single-consumer queue made of one ring per producer ("lane"). A producer
+// only ever touches its own lane, so its cost does not grow with the number of producers;
+// the consumer drains the lanes round-robin, one message per lane in turn.
+//
+// Sequenced mode keeps the global arrival order instead: each message takes the next number
+// of a shared counter when it is claimed, and the consumer hands messages out strictly in
+// that order, holding back a lane's head until its turn. The shared counter is the one point
+// where producers meet, so only enable it where the order across producers matters.
+template <typename T>
+class MpscLanes
+{
+public:
+    // Identifies a message handed out by peek(), for release()
+    struct Ticket
+    {
+        uint32_t lane;
+        size_t pos;
+    };
+
+    // 'lane_capacity' slots per lane; see AtomicRingBuffer for 'defer_init'
+    MpscLanes(size_t lane_capacity, uint32_t lanes, bool sequenced = false, bool defer_init = false)
+        : sequenced_(sequenced), held_(lanes)
+    {
+        lanes_.reserve(lanes);
+        for (uint32_t l = 0; l < lanes; ++l)
+            lanes_.push_back(std::make_unique<AtomicRingBuffer<T>>(lane_capacity, defer_init));
+        if (sequenced_)
+            seqs_.resize((size_t)lanes * lanes_[0]->capacity());
+    }
+
+    MpscLanes(const MpscLanes &) = delete;
+    MpscLanes &operator=(const MpscLanes &) = delete;
+
+    uint32_t lanes() const noexcept { return (uint32_t)lanes_.size(); }
+    bool sequenced() const noexcept { return sequenced_; }
+
+    void initialise() noexcept
+    {
+        for (auto &l : lanes_)
+            if (!l->ready())
+                l->initialise();
+    }
+    bool ready() const noexcept
+    {
+        for (const auto &l : lanes_)
+            if (!l->ready())
+                return false;
+        return true;
+    }
+
+    // ---- Producer 'lane' only ----
+
+    // Reserve the lane's next cell to build a message in place (nullptr if the lane is full)
+    T *claim(uint32_t lane, size_t &ticket) noexcept
+    {
+        T *cell = lanes_[lane]->claim(ticket);
+        if (cell != nullptr && sequenced_)
+            seq_at(lane, ticket) = next_.fetch_add(1, std::memory_order_relaxed);
+        return cell;
+    }
+
+    void commit(uint32_t lane, size_t ticket) noexcept { lanes_[lane]->commit(ticket); }
+
+    bool push(uint32_t lane, const T &item) noexcept
+    {
+        size_t ticket;
+        T *cell = claim(lane, ticket);
+        if (cell == nullptr)
+            return false;
+        *cell = item;
+        commit(lane, ticket);
+        return true;
+    }
+
+    // ---- Consumer ----
+
+    // Next message in place, or nullptr if none is ready (in sequenced mode: if the next
+    // number is not published yet). Release it once used; one message at a time.
+    const T *peek(Ticket &t) noexcept
+    {
+        const uint32_t n = lanes();
+        if (!sequenced_)
+        {
+            for (uint32_t k = 0; k < n; ++k)
+            {
+                const uint32_t l = cursor_;
+                cursor_ = cursor_ + 1 == n ? 0 : cursor_ + 1;
+                if (const T *item = lanes_[l]->peek(t.pos))
+                {
+                    t.lane = l;
+                    return item;
+                }
+            }
+            return nullptr;
+        }
+
+        // every lane's head is taken (held) until it is the next in order
+        for (uint32_t l = 0; l < n; ++l)
+        {
+            Held &h = held_[l];
+            if (h.item == nullptr && (h.item = lanes_[l]->peek(h.pos)) == nullptr)
+                continue;
+            if (seq_at(l, h.pos) == expected_)
+            {
+                t = Ticket{l, h.pos};
+                const T *item = h.item;
+                h.item = nullptr;
+                ++expected_;
+                return item;
+            }
+        }
+        return nullptr;
+    }
+
+    void release(const Ticket &t) noexcept { lanes_[t.lane]->release(t.pos); }
+
+    // Messages queued over all lanes (held heads included)
+    size_t size() const noexcept
+    {
+        size_t s = 0;
+        for (uint32_t l = 0; l < lanes(); ++l)
+            s += lanes_[l]->size() + (held_[l].item != nullptr);
+        return s;
+    }
+    bool empty() const noexcept { return size() == 0; }
+
+private:
+    struct Held
+    {
+        const T *item = nullptr;
+        size_t pos = 0;
+    };
+
+    bool sequenced_;
+    std::vector<std::unique_ptr<AtomicRingBuffer<T>>> lanes_;
+    std::vector<uint64_t> seqs_; // [lane][cell]: arrival number of the message in the cell
+
+    // consumer state
+    std::vector<Held> held_;
+    uint32_t cursor_ = 0;
+    uint64_t expected_ = 0;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> next_{0}; // sequenced mode only
+
+    inline uint64_t &seq_at(uint32_t lane, size_t pos) { return seqs_[(size_t)lane * lanes_[0]->capacity() + (pos & (lanes_[0]->capacity() - 1))]; }
+};
@@ -0,0 +1,203 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "Config.hpp"
+#include "OrderMsg.hpp"
+
+// Synthetic order flow over a set of instruments: random adds around mid plus a periodic cancel
+// of a random resting order, and optionally periodic mass quotes from a few market makers. Used by the pipeline generator (all instruments) and by each
+// reactor shard (its own instruments only), so both layouts see the same flow mix.
+class OrderFlow
+{
+public:
+    OrderFlow(const Config &cfg, const std::vector<uint32_t> &instruments, uint64_t seed)
+        : cfg_(cfg), instruments_(instruments), rng_(seed),
+          qty_dist_(1, cfg.max_qty), side_dist_(0, 1),
+          off_dist_(-(int32_t)cfg.span_ticks, (int32_t)cfg.span_ticks),
+          active_(cfg.num_instruments)
+    {
+        std::vector<double> w;
+        w.reserve(instruments_.size());
+        for (uint32_t inst : instruments_)
+        {
+            w.push_back(instrumentWeight(cfg, inst));
+            weight_ += w.back();
+        }
+        inst_dist_ = std::discrete_distribution<uint32_t>(w.begin(), w.end());
+    }
+
+    // Share of total flow sent to instrument 'inst' (instrument 0 is the hot one)
+    static double instrumentWeight(const Config &cfg, uint32_t inst)
+    {
+        const double hot = cfg.hot_instrument_pct / 100.0;
+        const double base = (1.0 - hot) / cfg.num_instruments;
+        return inst == 0 ? hot + base : base;
+    }
+
+    // Messages of a num_orders run generated for part 'part' of 'parts', where each part takes
+    // the instruments with instrument % parts == part. Split by cumulative weight so the parts
+    // sum exactly.
+    static uint64_t partOrders(const Config &cfg, uint32_t part, uint32_t parts)
+    {
+        double before = 0.0, upto = 0.0;
+        for (uint32_t i = 0; i < cfg.num_instruments; ++i)
+        {
+            const uint32_t p = i % parts;
+            const double w = instrumentWeight(cfg, i);
+            if (p < part)
+                before += w;
+            if (p <= part)
+                upto += w;
+        }
+        return (uint64_t)std::llround(upto * cfg.num_orders) - (uint64_t)std::llround(before * cfg.num_orders);
+    }
+
+    // Share of total flow covered by this flow's instruments
+    double weight() const { return weight_; }
+
+    // Build message number 'seq' (client ids are seq + 1)
+    inline void next(uint64_t seq, OrderMsg &msg)
+    {
+        prepare(seq);
+        build(msg);
+    }
+
+    // next() in two steps, for building the message where it will be read: prepare() makes
+    // the draws up to the instrument and returns it (ALL_INSTRUMENTS for a mass quote), then
+    // build() writes the message. Same flow as next().
+    inline uint32_t prepare(uint64_t seq)
+    {
+        seq_ = seq;
+        if (cfg_.mass_quote_every && seq % cfg_.mass_quote_every == cfg_.mass_quote_every - 1)
+            return instrument_ = ALL_INSTRUMENTS;
+        side_ = (uint8_t)side_dist_(rng_);
+        qty_ = qty_dist_(rng_);
+        off_ = off_dist_(rng_);
+        instrument_ = instruments_[inst_dist_(rng_)];
+        cancel_ = (cfg_.cancel_every > 0) && (seq % cfg_.cancel_every == 0) && (seq > 0) &&
+                  !active_[instrument_].empty();
+        return instrument_;
+    }
+
+    // Is the prepared message a cancel?
+    inline bool cancelling() const { return instrument_ != ALL_INSTRUMENTS && cancel_; }
+
+    inline void build(OrderMsg &msg)
+    {
+        if (instrument_ == ALL_INSTRUMENTS)
+        {
+            nextMassQuote(msg);
+            return;
+        }
+
+        const uint64_t seq = seq_;
+        const uint8_t side = side_;
+        const uint32_t qty = qty_;
+        const int32_t px = (int32_t)(Config::MAX_TICKS / 2) + off_;
+        const uint32_t instrument = instrument_;
+
+        msg.instrument = instrument;
+        msg.client_id = seq + 1;
+        msg.price_tick = (uint32_t)(px < 1 ? 1 : (px > (int32_t)Config::MAX_TICKS - 2 ? Config::MAX_TICKS - 2 : px));
+        msg.qty = qty;
+        msg.side = side;
+        msg.flags = 0;
+        if (cfg_.hidden_pct && rng_() % 100 < cfg_.hidden_pct)
+            msg.flags |= ORDER_HIDDEN;
+        if (cfg_.post_only_pct && rng_() % 100 < cfg_.post_only_pct)
+            msg.flags |= (rng_() & 1) ? ORDER_POST_SLIDE : ORDER_POST_ONLY;
+        msg.min_qty = 0;
+        if (cfg_.min_fill_pct && rng_() % 100 < cfg_.min_fill_pct)
+        {
+            // half all-or-none, half a minimum fill of up to the order size
+            const uint64_t r = rng_();
+            if (r & 1)
+                msg.flags |= ORDER_AON;
+            else
+                msg.min_qty = (uint32_t)((r >> 1) % qty) + 1;
+        }
+
+        // Cancel or new order, as decided by prepare()
+        auto &orders = active_[instrument];
+        if (cancel_)
+        {
+            // Pick a random active order on this instrument; swap-remove it
+            msg.msg_type = MessageType::CANCEL_ORDER;
+            size_t idx = rng_() % orders.size();
+            msg.handle_to_cancel = orders[idx];
+            orders[idx] = orders.back();
+            orders.pop_back();
+        }
+        else
+        {
+            // New order; the worker maps its client id to the engine handle
+            msg.msg_type = MessageType::ADD_ORDER;
+            msg.handle_to_cancel = 0;
+            msg.peg = PEG_NONE;
+            msg.peg_offset = 0;
+            if (cfg_.peg_pct && rng_() % 100 < cfg_.peg_pct)
+            {
+                const uint64_t r = rng_();
+                msg.peg = (r & 1) ? PEG_MID : PEG_PRIMARY;
+                msg.peg_offset = (uint8_t)((r >> 1) % 4);
+            }
+            else if (cfg_.dark_pct && rng_() % 100 < cfg_.dark_pct)
+            {
+                // dark midpoint order; a third of them ask for a minimum fill
+                const uint64_t r = rng_();
+                msg.peg = PEG_DARK;
+                msg.flags = 0;
+                msg.min_qty = (r % 3 == 0) ? (uint32_t)((r >> 8) % cfg_.max_qty) + 1 : 0;
+            }
+            orders.push_back((uint32_t)(seq + 1));
+        }
+    }
+
+private:
+    // A maker requotes a run of instruments a tick or two either side of mid. Prices repeat
+    // often enough that many updates are pure size changes. The receiver owns msg.quote.
+    void nextMassQuote(OrderMsg &msg)
+    {
+        auto *q = new MassQuote();
+        q->maker = (uint32_t)(rng_() % (cfg_.num_makers ? cfg_.num_makers : 1));
+        const size_t n = std::min<size_t>(cfg_.mass_quote_size, instruments_.size());
+        const size_t start = rng_() % instruments_.size();
+        const uint32_t mid = Config::MAX_TICKS / 2;
+        q->entries.resize(n);
+        for (size_t k = 0; k < n; ++k)
+        {
+            QuoteEntry &e = q->entries[k];
+            const uint64_t r = rng_();
+            e.instrument = instruments_[(start + k) % instruments_.size()];
+            e.bid_tick = mid - 1 - (uint32_t)(r % 3);
+            e.ask_tick = mid + 1 + (uint32_t)((r >> 8) % 3);
+            e.bid_qty = (uint32_t)((r >> 16) % cfg_.max_qty) + 1;
+            e.ask_qty = (uint32_t)((r >> 32) % cfg_.max_qty) + 1;
+        }
+        msg.msg_type = MessageType::MASS_QUOTE;
+        msg.instrument = ALL_INSTRUMENTS;
+        msg.quote = q;
+    }
+
+    const Config &cfg_;
+    std::vector<uint32_t> instruments_;
+    std::mt19937_64 rng_;
+    std::uniform_int_distribution<uint32_t> qty_dist_;
+    std::uniform_int_distribution<uint32_t> side_dist_;
+    std::uniform_int_distribution<int32_t> off_dist_;
+    std::discrete_distribution<uint32_t> inst_dist_;
+    double weight_{0.0};
+
+    // Draws made by prepare() for build()
+    uint64_t seq_{0};
+    uint32_t instrument_{0};
+    uint32_t qty_{0};
+    int32_t off_{0};
+    uint8_t side_{0};
+    bool cancel_{false};
+
+    // Active client ids per instrument, candidates for cancellation
+    std::vector<std::vector<uint32_t>> active_;
+};
@@ -4,28 +4,48 @@
 #include <atomic>
 #include "Config.hpp"
 #include "OrderMsg.hpp"
-#include "AtomicRingBuffer.hpp"
+#include "MpscLanes.hpp"
 #include "OrderManager.hpp"
 #include "Stats.hpp"
+#include "InstrumentBook.hpp"
 #include <vector>
 
 class OrderGenerator
 {
 public:
-    // Accept vector of per-worker ring pointers to route orders directly to each worker (SPSC per ring)
-    OrderGenerator(std::vector<AtomicRingBuffer<OrderMsg> *> &rings,
+    // One gateway of 'gateways': it generates the flow of the instruments with
+    // instrument % gateways == gateway and feeds its own lane of every worker's queue.
+    // 'running' counts gateways still generating; the last one to finish raises 'done_flag'.
+    // 'cancel_queues' are the workers' priority lanes for cancels (empty: cancels go in order).
+    OrderGenerator(std::vector<MpscLanes<OrderMsg> *> &queues,
+                   std::vector<MpscLanes<OrderMsg> *> &cancel_queues,
+                   uint32_t gateway,
+                   uint32_t gateways,
+                   std::atomic<uint32_t> &running,
                    OrderManager &om,
                    const Config &cfg,
                    std::atomic<bool> &done_flag,
-                   Stats &stats);
+                   Stats &stats,
+                   InstrumentDirectory &dir);
 
     void operator()(); // thread entry
 
 private:
-    std::vector<AtomicRingBuffer<OrderMsg> *> &rings_;
+    std::vector<MpscLanes<OrderMsg> *> &rings_;
+    std::vector<MpscLanes<OrderMsg> *> &cancel_rings_;
+    uint32_t gateway_;
+    uint32_t gateways_;
+    std::atomic<uint32_t> &running_;
     OrderManager &om_;
     const Config cfg_;
     std::atomic<bool> &done_;
     Stats &stats_;
-    uint32_t cur_worker_{0};
+    InstrumentDirectory &dir_;
+
+    // Symbol-affine routing: instrument -> worker. Flipped only by applyMigration.
+    std::vector<uint32_t> route_;
+    uint64_t route_epoch_{0};
+
+    void applyMigration(uint32_t instrument, uint32_t to);
+    uint32_t dispatchMassQuote(OrderMsg &msg);
 };
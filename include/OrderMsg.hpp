@@ -1,16 +1,29 @@
 #pragma once
 #include "MatchingEngine.hpp" // defines OrderIn, SIDE_BUY/SELL
+#include "MassQuote.hpp"
 
 enum class MessageType : uint8_t
 {
     ADD_ORDER = 0,
-    CANCEL_ORDER = 1
+    CANCEL_ORDER = 1,
+    MIGRATE_OUT = 2, // hand the instrument's book to worker_id (drain barrier)
+    MASS_QUOTE = 3   // apply this worker's entries of 'quote'
 };
 
+// 'instrument' of a MASS_QUOTE message: every entry routed to the worker (a parked copy
+// names the single instrument it was held for)
+constexpr uint32_t ALL_INSTRUMENTS = ~0u;
+
 // Extend incoming message with routing hint for worker (round-robin/shard)
 struct OrderMsg : public OrderIn
 {
     uint32_t worker_id = 0;                        // target worker queue
     MessageType msg_type = MessageType::ADD_ORDER; // message type
     uint32_t handle_to_cancel = 0;                 // for cancel messages, which handle to cancel
+    uint32_t instrument = 0;                       // instrument (book) this message targets
+    MassQuote *quote = nullptr;                    // for mass quotes, the shared entries (one reference)
+
+    // Latency sampling stamps (TSC). Zero unless the generator sampled this message.
+    uint64_t t_gen = 0;  // when the message was generated
+    uint64_t t_push = 0; // when it was committed to the ring
 };
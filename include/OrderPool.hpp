@@ -0,0 +1,216 @@
+// OrderPool.hpp
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <memory>
+#include <vector>
+#include "EngineCounters.hpp"
+
+// helpful branch prediction micro optimization
+#ifndef likely
+#  define likely(x)   __builtin_expect(!!(x), 1)
+#  define unlikely(x) __builtin_expect(!!(x), 0)
+#endif
+
+enum : uint8_t { SIDE_BUY = 0, SIDE_SELL = 1 };
+
+// OrderNode::flags
+enum : uint8_t {
+    NODE_PEGGED   = 0x1, // rests in a peg queue; price_tick holds the peg key
+    NODE_HIDDEN   = 0x2, // rests in its level's hidden queue
+    NODE_DARK     = 0x4, // rests in the dark midpoint book; price_tick holds the minimum fill
+    NODE_MIN_FILL = 0x8, // displayed order with a minimum fill (OrderPool::min_fill)
+};
+
+// intrusive order node (it resides in a contiguous pool)
+struct OrderNode {
+    uint32_t id; // engine handle (index into handle_)
+    uint32_t price_tick;
+    uint32_t qty; // remaining
+    uint32_t next_idx; // index in pool_ (NIL if none); free-list link while free
+    uint32_t prev_idx; // index in pool_ (NIL if none); free-list back link while free
+    uint8_t  side; // store SIDE_BUY/SIDE_SELL
+    uint8_t  flags{0}; // NODE_* kind bits
+    uint16_t book; // owning ladder when several books share one pool
+};
+
+// Order nodes plus the handle table, grown in fixed-size segments up to MAX_ORDERS. Indices
+// (and handles) are stable across growth: index -> segment is a shift and a mask, and segments
+// are never moved. One pool can back a single book (MatchingEngine) or many small books on the
+// same worker (EngineGroup). The free list is doubly linked so compaction can claim a
+// specific free slot in O(1).
+template <uint32_t MAX_ORDERS, uint32_t SEGMENT_SHIFT = 16>
+class OrderPool {
+public:
+    static constexpr uint32_t NIL = 0xFFFFFFFFu;
+    static constexpr uint32_t CAPACITY = MAX_ORDERS; // upper bound
+    static constexpr uint32_t SEGMENT = 1u << SEGMENT_SHIFT;
+    static constexpr uint32_t SEGMENT_MASK = SEGMENT - 1u;
+    static constexpr uint32_t MAX_SEGMENTS = (MAX_ORDERS + SEGMENT - 1u) / SEGMENT;
+    static constexpr uint32_t LOW_WATER = SEGMENT / 8; // free nodes left when grow_if_low() adds a segment
+
+    explicit OrderPool(uint32_t initial = SEGMENT) : initial_(initial ? initial : 1) { reset(); }
+
+    // Drop to the initial segments and clear them (not thread-safe. call on init/reset only)
+    void reset() {
+        const uint32_t keep = (initial_ < MAX_ORDERS ? initial_ : MAX_ORDERS) + SEGMENT_MASK;
+        for (uint32_t s = keep >> SEGMENT_SHIFT; s < MAX_SEGMENTS; ++s) segs_[s].reset();
+        capacity_ = 0;
+        free_head_ = NIL;
+        free_count_ = 0;
+        next_handle_ = 0;
+        scan_cursor_ = 0;
+        min_fill_.clear();
+        while (capacity_ < initial_ && grow()) {}
+    }
+
+    inline OrderNode& node(uint32_t idx) { return segs_[idx >> SEGMENT_SHIFT]->nodes[idx & SEGMENT_MASK]; }
+    inline const OrderNode& node(uint32_t idx) const { return segs_[idx >> SEGMENT_SHIFT]->nodes[idx & SEGMENT_MASK]; }
+
+    // handle -> pool index (NIL if not active)
+    inline uint32_t lookup(uint32_t handle) const {
+        if (unlikely(handle >= capacity_)) return NIL;
+        return handle_slot(handle);
+    }
+
+    // ---- Pool helpers ----
+    inline uint32_t alloc_node() {
+        // grow inline only as a last resort; grow_if_low() keeps this off the hot path
+        if (unlikely(free_head_ == NIL) && !grow()) return NIL;
+        uint32_t idx = free_head_;
+        OrderNode& n = node(idx);
+        free_head_ = n.next_idx;
+        if (free_head_ != NIL) node(free_head_).prev_idx = NIL;
+        --free_count_;
+        ENGINE_SAMPLE(FreeListDepth, free_count_);
+        n.next_idx = NIL;
+        n.prev_idx = NIL;
+        return idx;
+    }
+    inline void free_node(uint32_t idx) {
+        OrderNode& n = node(idx);
+        n.next_idx = free_head_;
+        n.prev_idx = NIL;
+        if (free_head_ != NIL) node(free_head_).prev_idx = idx;
+        free_head_ = idx;
+        ++free_count_;
+    }
+    // return a doubly linked chain head..tail of 'count' nodes (a level's FIFO, head's prev_idx
+    // already NIL) to the free list in one step
+    inline void free_chain(uint32_t head, uint32_t tail, uint32_t count) {
+        node(tail).next_idx = free_head_;
+        if (free_head_ != NIL) node(free_head_).prev_idx = tail;
+        free_head_ = head;
+        free_count_ += count;
+    }
+
+    // assign a free handle to node 'idx' (O(1), wrap-safe). returns the handle
+    inline uint32_t assign_handle(uint32_t idx) {
+        uint32_t h = next_handle_;
+        for (;;) {
+            if (handle_slot(h) == NIL) {
+                ENGINE_SAMPLE(HandleProbes, (h + capacity_ - next_handle_) % capacity_ + 1u);
+                handle_slot(h) = idx;
+                next_handle_ = (h + 1u) % capacity_;
+                break;
+            }
+            h = (h + 1u) % capacity_;
+        }
+        node(idx).id = h;
+        return h;
+    }
+    inline void release_handle(uint32_t handle) { handle_slot(handle) = NIL; }
+
+    // Minimum fill of a NODE_MIN_FILL order, by handle. Kept here rather than in the node so
+    // it survives a ladder being compacted away; the table is only allocated once used.
+    inline void set_min_fill(uint32_t handle, uint32_t qty) {
+        if (unlikely(handle >= min_fill_.size())) min_fill_.resize(capacity_);
+        min_fill_[handle] = qty;
+    }
+    inline uint32_t min_fill(uint32_t handle) const { return min_fill_[handle]; }
+
+    // ---- Compaction helpers ----
+    // A node is live iff its handle still points back at it
+    inline bool is_free(uint32_t idx) const { return lookup(node(idx).id) != idx; }
+
+    // Claim the specific free node 'idx' (O(1) unlink from the free list)
+    inline void take_free(uint32_t idx) {
+        OrderNode& n = node(idx);
+        if (n.prev_idx != NIL) node(n.prev_idx).next_idx = n.next_idx; else free_head_ = n.next_idx;
+        if (n.next_idx != NIL) node(n.next_idx).prev_idx = n.prev_idx;
+        --free_count_;
+    }
+
+    // Point an active handle at the node's new index after a move
+    inline void rebind_handle(uint32_t handle, uint32_t idx) { handle_slot(handle) = idx; }
+
+    // Find 'count' consecutive free nodes, examining at most 'max_scan' slots from a rotating
+    // cursor. Returns the first index of the run or NIL.
+    uint32_t find_free_run(uint32_t count, uint32_t max_scan) {
+        if (count == 0 || count > capacity_) return NIL;
+        uint32_t run = 0;
+        for (uint32_t i = 0; i < max_scan; ++i) {
+            const uint32_t idx = scan_cursor_;
+            scan_cursor_ = (scan_cursor_ + 1u == capacity_) ? 0 : scan_cursor_ + 1u;
+            if (idx == 0) run = 0; // runs do not wrap
+            if (!is_free(idx)) { run = 0; continue; }
+            if (++run == count) return idx + 1u - count;
+        }
+        return NIL;
+    }
+
+    // Add one segment. Returns false at MAX_ORDERS.
+    bool grow() {
+        if (capacity_ >= MAX_ORDERS) return false;
+        const uint32_t s = capacity_ >> SEGMENT_SHIFT;
+        if (!segs_[s]) segs_[s] = std::make_unique<Segment>();
+        const uint32_t first = capacity_;
+        const uint32_t last = (first + SEGMENT < MAX_ORDERS ? first + SEGMENT : MAX_ORDERS) - 1u;
+        Segment& seg = *segs_[s];
+        for (uint32_t i = first; i <= last; ++i) {
+            OrderNode& n = seg.nodes[i & SEGMENT_MASK];
+            n.next_idx = (i == last) ? free_head_ : i + 1u; // new nodes go in front of the free list
+            n.prev_idx = (i == first) ? NIL : i - 1u;
+            n.qty = 0;
+            seg.handles[i & SEGMENT_MASK] = NIL;
+        }
+        if (free_head_ != NIL) node(free_head_).prev_idx = last;
+        free_head_ = first;
+        free_count_ += last - first + 1u;
+        capacity_ = last + 1u;
+        return true;
+    }
+
+    // Grow until at least 'n' nodes are free. Returns false if MAX_ORDERS does not allow it.
+    bool reserve(uint32_t n) {
+        while (free_count_ < n && grow()) {}
+        return free_count_ >= n;
+    }
+
+    // Called between batches: add a segment before the free list runs dry
+    inline bool grow_if_low() {
+        return unlikely(free_count_ < LOW_WATER) && grow();
+    }
+
+    uint32_t capacity() const { return capacity_; }
+    uint32_t free_count() const { return free_count_; }
+
+private:
+    struct Segment {
+        std::array<OrderNode, SEGMENT> nodes;
+        std::array<uint32_t, SEGMENT> handles; // handle -> pool index (NIL if not active)
+    };
+
+    std::array<std::unique_ptr<Segment>, MAX_SEGMENTS> segs_{};
+    uint32_t initial_;
+    uint32_t capacity_{0};     // nodes (and handles) currently backed by segments
+    uint32_t free_head_{NIL};  // free-list head (pool index)
+    uint32_t free_count_{0};
+    uint32_t next_handle_{0};  // next candidate handle (wraps)
+    uint32_t scan_cursor_{0};  // find_free_run resume point
+    std::vector<uint32_t> min_fill_; // handle -> minimum fill (NODE_MIN_FILL orders only)
+
+    inline uint32_t& handle_slot(uint32_t h) { return segs_[h >> SEGMENT_SHIFT]->handles[h & SEGMENT_MASK]; }
+    inline uint32_t handle_slot(uint32_t h) const { return segs_[h >> SEGMENT_SHIFT]->handles[h & SEGMENT_MASK]; }
+};
@@ -0,0 +1,1287 @@
+// PriceLadder.hpp
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <cassert>
+#include <cstring> // memset
+#include <vector>
+#include <memory>
+#include <bit> // this is countr_zero/countl_zero from C++20
+#include "OrderPool.hpp"
+#include "QueuePosition.hpp"
+#include "VolumeProfile.hpp"
+
+// OrderIn::flags
+enum : uint8_t {
+    ORDER_IOC        = 0x1,
+    ORDER_FOK        = 0x2,
+    ORDER_POST_ONLY  = 0x4,  // reject instead of taking liquidity
+    ORDER_POST_SLIDE = 0x8,  // post-only, repriced one tick inside the opposite touch instead of rejected
+    ORDER_HIDDEN     = 0x10, // rest fully hidden, behind the level's displayed quantity
+    ORDER_AON        = 0x20, // all-or-none: trade the whole quantity in one go or not at all
+};
+
+// peg instructions (OrderIn::peg)
+enum : uint8_t { PEG_NONE = 0, PEG_MID = 1, PEG_PRIMARY = 2, PEG_DARK = 3 };
+
+// incoming order message input
+struct OrderIn {
+    uint64_t client_id; // who sent it (passthrough)
+    uint32_t price_tick; // price tick (0..MAX_TICKS-1); unused by PEG_DARK
+    uint32_t qty; // >0
+    uint8_t  side; // 0=BUY, 1=SELL
+    uint8_t  flags; // ORDER_* bits
+    uint8_t  peg{PEG_NONE}; // PEG_MID: rest at the lit midpoint, PEG_PRIMARY: at the same-side touch,
+                            // PEG_DARK: cross only with other dark orders, at the lit midpoint
+    uint8_t  peg_offset{0}; // primary pegs: ticks behind the touch (< PEG_OFFSETS)
+    uint32_t min_qty{0}; // minimum fill (0 = none): displayed limit and PEG_DARK orders only
+};
+
+// Column arrays for bulk loading (PriceLadder::load); 'owner' is only passed through
+struct BulkOrders {
+    const uint8_t*  side;
+    const uint32_t* tick;
+    const uint32_t* qty;
+    const uint64_t* owner; // may be nullptr
+    size_t count;
+};
+
+// One instrument's tick ladder: price levels, occupancy bitsets and best prices.
+// Order nodes and handles live in an external Pool, which may be shared by many ladders.
+//
+// Pegged orders live outside the ladder in FIFO queues keyed by peg (midpoint, or primary
+// offset 0..PEG_OFFSETS-1) and carry no price. Their effective price is derived from the lit
+// BBO when an aggressor looks for liquidity, so a BBO change reprices every peg at no cost.
+//
+// Hidden orders rest in a second per-level queue behind the displayed one, outside total_qty
+// and the published best prices. The occupancy bitsets and internal best prices cover both
+// queues, so an aggressor drains displayed then hidden quantity at each level in one pass; the
+// hidden bitset is only consulted while some hidden level exists.
+//
+// Dark midpoint orders sit in one FIFO per side, invisible to lit flow, and cross only with
+// each other at the lit midpoint, honouring each order's minimum fill. Whether two dark orders
+// can trade does not depend on where the midpoint is, only that there is one, so an arrival is
+// matched against the opposite FIFO once (plus a settling pass if a partial fill lowered some
+// order's minimum); the lit path only checks a flag, set while arrivals wait for the book to
+// become two-sided again.
+//
+// All-or-none and minimum-quantity orders rest in the ordinary displayed FIFO. A trade too
+// small for such a maker passes over it without costing it its place. Each level tracks the
+// quantity of these makers, so the crossing loop keeps its plain FIFO path for levels without
+// any, and a sweep that takes the whole level satisfies every minimum anyway. An order left
+// within reach of makers it was too small for does not rest through them: the remainder is
+// dropped as if it were IOC.
+//
+// The ladder keeps a Zobrist-style hash of its resting orders (see order_key), updated in O(1)
+// on every rest, fill, amend and cancel, so two books can be compared for the cost of one load.
+// It also records every fill in a per-tick volume profile (dark crosses at the floor of the mid).
+template <uint32_t MAX_TICKS, typename Pool, uint32_t WORD_BITS = 64>
+class PriceLadder {
+    static_assert(MAX_TICKS >= 2, "need at least two ticks");
+    static_assert(WORD_BITS == 64, "WORD_BITS must be 64");
+    static constexpr uint32_t WORDS = (MAX_TICKS + WORD_BITS - 1u) / WORD_BITS;
+
+public:
+    static constexpr uint32_t NIL      = 0xFFFFFFFFu;
+    static constexpr uint32_t NO_PRICE = 0xFFFFFFFFu;
+    static constexpr uint32_t DONE_FILL= 0xFFFFFFFEu;
+
+    static constexpr uint32_t PEG_OFFSETS = 8;
+    static constexpr uint32_t PEG_KEY_MID = 0;
+    static constexpr uint32_t PEG_KEY_PRIMARY = 1; // + offset
+    static constexpr uint32_t PEG_KEYS = PEG_KEY_PRIMARY + PEG_OFFSETS;
+
+    struct PriceLevel {
+        uint32_t head{NIL};
+        uint32_t tail{NIL};
+        uint32_t total_qty{0}; // book-keeping (not used in hot path decisions)
+        uint32_t min_fill_qty{0}; // part of total_qty resting with a minimum fill (NODE_MIN_FILL)
+    };
+
+    // Compact image of a ladder: occupied levels only. The orders themselves stay linked in the
+    // pool, so handles remain valid while the ladder is not materialised.
+    struct SavedLevel {
+        uint32_t tick;  // or peg key
+        uint8_t  side;  // | SAVED_PEG for a peg queue
+        PriceLevel level;
+    };
+    static constexpr uint8_t SAVED_PEG    = 0x80;
+    static constexpr uint8_t SAVED_HIDDEN = 0x40;
+    static constexpr uint8_t SAVED_DARK   = 0x20;
+    struct SavedVolume {
+        uint32_t tick;
+        uint32_t trades;
+        uint64_t volume;
+    };
+    struct Image {
+        std::vector<SavedLevel> levels;
+        std::vector<SavedVolume> profile; // ticks that have traded
+        bool dark_pending{false};
+        uint32_t best_bid{NO_PRICE};  // displayed best prices, for queries on the image
+        uint32_t best_ask{NO_PRICE};
+        uint32_t inner_bid{NO_PRICE}; // internal best prices (hidden levels included)
+        uint32_t inner_ask{NO_PRICE};
+        uint64_t trades{0};
+        uint64_t volume{0};
+        uint64_t dark_trades{0};
+        uint64_t dark_volume{0};
+        uint64_t hash{0};
+    };
+
+    // Bind to the pool that holds this ladder's orders; 'book' tags its nodes
+    void attach(Pool* pool, uint16_t book) { pool_ = pool; book_ = book; }
+
+    // Clear levels and bitsets (the pool is reset by its owner)
+    void reset() {
+        std::memset(bids_bits_.data(), 0, sizeof(uint64_t) * WORDS);
+        std::memset(asks_bits_.data(), 0, sizeof(uint64_t) * WORDS);
+        for (uint32_t i = 0; i < MAX_TICKS; ++i) { bids_[i] = PriceLevel{}; asks_[i] = PriceLevel{}; }
+        if (hidden_levels_ != 0) {
+            for (uint32_t i = 0; i < MAX_TICKS; ++i) { hidden_bids_[i] = PriceLevel{}; hidden_asks_[i] = PriceLevel{}; }
+            hidden_bids_bits_.fill(0);
+            hidden_asks_bits_.fill(0);
+            hidden_levels_ = 0;
+        }
+
+        best_bid_ = NO_PRICE;
+        best_ask_ = NO_PRICE;
+        for (auto& side : pegs_) side.fill(PriceLevel{});
+        peg_mask_[SIDE_BUY] = peg_mask_[SIDE_SELL] = 0;
+        dark_.fill(PriceLevel{});
+        dark_pending_ = false;
+        if (queue_) queue_->reset();
+        profile_.reset();
+
+        total_trades_ = 0;
+        total_volume_ = 0;
+        dark_trades_ = 0;
+        dark_volume_ = 0;
+        state_hash_ = 0;
+    }
+
+    // Use to add a limit (or pegged) order. Returns engine handle on rest, DONE_FILL if fully executed, or NIL on reject.
+    inline uint32_t add_limit(const OrderIn& in) {
+        uint32_t r;
+        if (unlikely(in.peg == PEG_DARK)) return add_dark(in);
+        if (unlikely(in.peg != PEG_NONE)) r = add_peg(in);
+        else if (unlikely(in.flags & (ORDER_POST_ONLY | ORDER_POST_SLIDE))) r = add_post_only(in);
+        else r = add_lit(in);
+        if (unlikely(peg_mask_[SIDE_BUY] & peg_mask_[SIDE_SELL] & (1u << PEG_KEY_MID))) uncross_mid_pegs();
+        if (unlikely(hidden_levels_ != 0 && (peg_mask_[SIDE_BUY] | peg_mask_[SIDE_SELL]) != 0)) uncross_hidden_pegs();
+        if (unlikely(dark_pending_)) cross_dark();
+        ENGINE_END_ORDER();
+        return r;
+    }
+
+    // Cancel the resting order at pool index 'idx' (must belong to this ladder)
+    inline void cancel_node(uint32_t idx) {
+        const uint8_t flags = node(idx).flags;
+        toggle_hash(node(idx));
+        if (unlikely(flags & NODE_PEGGED)) { cancel_peg(idx); return; }
+        if (unlikely(flags & NODE_DARK)) { remove_dark(idx); return; }
+        cancel_lit(idx);
+        if (unlikely(peg_mask_[SIDE_BUY] & peg_mask_[SIDE_SELL] & (1u << PEG_KEY_MID))) uncross_mid_pegs();
+        if (unlikely(hidden_levels_ != 0 && (peg_mask_[SIDE_BUY] | peg_mask_[SIDE_SELL]) != 0)) uncross_hidden_pegs();
+        if (unlikely(dark_pending_)) cross_dark();
+    }
+
+    // Shrink a resting displayed order to 'qty' (> 0) at the same price, keeping its queue
+    // priority. Returns false (nothing changed) if that is not a pure size reduction.
+    inline bool amend_in_place(uint32_t idx, uint32_t tick, uint32_t qty) {
+        OrderNode& n = node(idx);
+        if (n.flags != 0 || n.price_tick != tick || qty > n.qty) return false;
+        const uint32_t cut = n.qty - qty;
+        toggle_hash(n);
+        n.qty = qty;
+        toggle_hash(n);
+        ((n.side == SIDE_BUY) ? bids_[tick] : asks_[tick]).total_qty -= cut;
+        if (unlikely(queue_ != nullptr) && cut != 0) queue_->reduce(n.side, tick, n.id, cut);
+        return true;
+    }
+
+    // Build an empty ladder from 'in': displayed orders sorted by side (buys first), then tick
+    // ascending, FIFO within a tick. One sequential pass links each level's run of nodes, assigns
+    // handles (written to handles[i] if given) and sets the bits, with no matching. Returns false,
+    // loading nothing, if the ladder is not empty, the input is unsorted or out of range, the
+    // bids would cross the asks, or the pool cannot take 'count' more orders.
+    bool load(const BulkOrders& in, uint32_t* handles) {
+        if (best_bid_ != NO_PRICE || best_ask_ != NO_PRICE || (peg_mask_[SIDE_BUY] | peg_mask_[SIDE_SELL]) != 0 ||
+            dark_[SIDE_BUY].head != NIL || dark_[SIDE_SELL].head != NIL) return false;
+        uint32_t top_bid = NO_PRICE, low_ask = NO_PRICE;
+        for (size_t i = 0; i < in.count; ++i) {
+            if (in.side[i] > SIDE_SELL || in.tick[i] >= MAX_TICKS || in.qty[i] == 0) return false;
+            if (i != 0 && (in.side[i] < in.side[i - 1] || (in.side[i] == in.side[i - 1] && in.tick[i] < in.tick[i - 1])))
+                return false;
+            if (in.side[i] == SIDE_BUY) top_bid = in.tick[i];
+            else if (low_ask == NO_PRICE) low_ask = in.tick[i];
+        }
+        if (top_bid != NO_PRICE && low_ask != NO_PRICE && top_bid >= low_ask) return false;
+        if (in.count > Pool::CAPACITY || !pool_->reserve((uint32_t)in.count)) return false;
+
+        for (size_t i = 0; i < in.count; ++i) {
+            const uint32_t idx = pool_->alloc_node();
+            OrderNode& n = node(idx);
+            n.price_tick = in.tick[i];
+            n.qty        = in.qty[i];
+            n.side       = in.side[i];
+            n.flags      = 0;
+            n.book       = book_;
+            const uint32_t handle = pool_->assign_handle(idx);
+
+            PriceLevel& lvl = (n.side == SIDE_BUY) ? bids_[n.price_tick] : asks_[n.price_tick];
+            n.prev_idx = lvl.tail;
+            n.next_idx = NIL;
+            if (lvl.tail != NIL) node(lvl.tail).next_idx = idx;
+            else { lvl.head = idx; set_bit(n.side == SIDE_BUY ? bids_bits_ : asks_bits_, n.price_tick); }
+            lvl.tail = idx;
+            lvl.total_qty += n.qty;
+            if (unlikely(queue_ != nullptr)) queue_->rest(n.side, n.price_tick, handle, n.qty);
+            toggle_hash(n);
+            if (handles) handles[i] = handle;
+        }
+        best_bid_ = top_bid;
+        best_ask_ = low_ask;
+        return true;
+    }
+
+    // Capture occupied levels, best prices and totals into 'img' (O(WORDS + occupied levels))
+    void save(Image& img) const {
+        img.levels.clear();
+        for (uint32_t w = 0; w < WORDS; ++w) {
+            for (uint64_t m = bids_bits_[w]; m; m &= m - 1) {
+                const uint32_t tick = w * WORD_BITS + std::countr_zero(m);
+                if (bids_[tick].head != NIL) img.levels.push_back(SavedLevel{tick, SIDE_BUY, bids_[tick]});
+            }
+            for (uint64_t m = asks_bits_[w]; m; m &= m - 1) {
+                const uint32_t tick = w * WORD_BITS + std::countr_zero(m);
+                if (asks_[tick].head != NIL) img.levels.push_back(SavedLevel{tick, SIDE_SELL, asks_[tick]});
+            }
+        }
+        if (hidden_levels_ != 0) {
+            for (uint32_t w = 0; w < WORDS; ++w) {
+                for (uint64_t m = hidden_bids_bits_[w]; m; m &= m - 1) {
+                    const uint32_t tick = w * WORD_BITS + std::countr_zero(m);
+                    img.levels.push_back(SavedLevel{tick, (uint8_t)(SIDE_BUY | SAVED_HIDDEN), hidden_bids_[tick]});
+                }
+                for (uint64_t m = hidden_asks_bits_[w]; m; m &= m - 1) {
+                    const uint32_t tick = w * WORD_BITS + std::countr_zero(m);
+                    img.levels.push_back(SavedLevel{tick, (uint8_t)(SIDE_SELL | SAVED_HIDDEN), hidden_asks_[tick]});
+                }
+            }
+        }
+        for (uint8_t side = SIDE_BUY; side <= SIDE_SELL; ++side)
+            for (uint32_t m = peg_mask_[side]; m; m &= m - 1) {
+                const uint32_t key = std::countr_zero(m);
+                img.levels.push_back(SavedLevel{key, (uint8_t)(side | SAVED_PEG), pegs_[side][key]});
+            }
+        for (uint8_t side = SIDE_BUY; side <= SIDE_SELL; ++side)
+            if (dark_[side].head != NIL) img.levels.push_back(SavedLevel{0, (uint8_t)(side | SAVED_DARK), dark_[side]});
+        img.profile.clear();
+        for (uint32_t t = 0; t < MAX_TICKS; ++t)
+            if (profile_.trades_at(t) != 0) img.profile.push_back(SavedVolume{t, profile_.trades_at(t), profile_.volume_at(t)});
+        img.dark_pending = dark_pending_;
+        img.best_bid = best_bid();
+        img.best_ask = best_ask();
+        img.inner_bid = best_bid_;
+        img.inner_ask = best_ask_;
+        img.trades = total_trades_;
+        img.volume = total_volume_;
+        img.dark_trades = dark_trades_;
+        img.dark_volume = dark_volume_;
+        img.hash = state_hash_;
+    }
+
+    // Rebuild from 'img' and release its level storage
+    void restore(Image& img) {
+        reset();
+        for (const SavedLevel& s : img.levels) {
+            if (s.side & SAVED_DARK) dark_[s.side & ~SAVED_DARK] = s.level;
+            else if (s.side & SAVED_PEG) {
+                const uint8_t side = s.side & ~SAVED_PEG;
+                pegs_[side][s.tick] = s.level;
+                peg_mask_[side] |= 1u << s.tick;
+            }
+            else if (s.side & SAVED_HIDDEN) {
+                const uint8_t side = s.side & ~SAVED_HIDDEN;
+                level_hidden(side, s.tick) = s.level;
+                set_bit(side == SIDE_BUY ? hidden_bids_bits_ : hidden_asks_bits_, s.tick);
+                set_bit(side == SIDE_BUY ? bids_bits_ : asks_bits_, s.tick);
+                ++hidden_levels_;
+            }
+            else if (s.side == SIDE_BUY) { bids_[s.tick] = s.level; set_bit(bids_bits_, s.tick); }
+            else                    { asks_[s.tick] = s.level; set_bit(asks_bits_, s.tick); }
+        }
+        best_bid_ = img.inner_bid;
+        best_ask_ = img.inner_ask;
+        total_trades_ = img.trades;
+        total_volume_ = img.volume;
+        dark_trades_ = img.dark_trades;
+        dark_volume_ = img.dark_volume;
+        state_hash_ = img.hash;
+        dark_pending_ = img.dark_pending;
+        for (const SavedVolume& v : img.profile) profile_.add(v.tick, v.volume, v.trades);
+        img.levels.clear();
+        img.levels.shrink_to_fit();
+        img.profile.clear();
+        img.profile.shrink_to_fit();
+    }
+
+    // Incremental compaction: relocate the live orders of the busiest levels (the COMPACT_DEPTH
+    // levels nearest the touch on each side) into contiguous pool runs in FIFO order, so a
+    // sweep reads consecutive cache lines. Moves at most 'budget' nodes; call between batches.
+    // A level deeper than 'budget' is compacted over several calls. Returns the number of nodes moved.
+    static constexpr uint32_t COMPACT_DEPTH = 4;
+
+    uint32_t compact(uint32_t budget) {
+        uint32_t moved = 0;
+        for (uint32_t visited = 0; visited < 2 * COMPACT_DEPTH && moved < budget; ++visited) {
+            const uint32_t slot = compact_cursor_;
+            compact_cursor_ = (compact_cursor_ + 1u) % (2 * COMPACT_DEPTH);
+            const bool buy = slot < COMPACT_DEPTH;
+            const uint32_t tick = nth_level(buy, slot % COMPACT_DEPTH);
+            if (tick == NO_PRICE) continue;
+            moved += compact_level(buy ? bids_[tick] : asks_[tick], budget - moved);
+        }
+        return moved;
+    }
+
+    // Queue position: quantity resting ahead of the order at pool index 'idx' at its level.
+    // O(log n) with the index enabled, otherwise a walk towards the level head.
+    using QueueIndex = QueuePositionIndex<MAX_TICKS>;
+
+    // Turn the index on or off (a few MB per ladder while on). It only learns orders as they
+    // rest, so turning it on fails, changing nothing, while any displayed or hidden level is occupied.
+    bool enable_queue_position(bool on) {
+        if (!on) { queue_.reset(); return true; }
+        if (queue_) return true;
+        if (best_bid_ != NO_PRICE || best_ask_ != NO_PRICE) return false;
+        queue_ = std::make_unique<QueueIndex>();
+        return true;
+    }
+    bool queue_position_enabled() const { return queue_ != nullptr; }
+
+    inline uint64_t queue_ahead(uint32_t idx) {
+        const OrderNode& n = node(idx);
+        if (queue_ && !(n.flags & (NODE_PEGGED | NODE_HIDDEN | NODE_DARK))) return queue_->ahead(n.side, n.price_tick, n.id);
+        uint64_t ahead = 0;
+        for (uint32_t p = n.prev_idx; p != NIL; p = node(p).prev_idx) ahead += node(p).qty;
+        return ahead;
+    }
+
+    // Query best displayed prices (NO_PRICE if empty); hidden-only levels are not published
+    inline uint32_t best_bid() const { return likely(hidden_levels_ == 0) ? best_bid_ : displayed_best(SIDE_BUY); }
+    inline uint32_t best_ask() const { return likely(hidden_levels_ == 0) ? best_ask_ : displayed_best(SIDE_SELL); }
+
+    // Displayed quantity at the best displayed price (0 if empty)
+    inline uint32_t best_bid_qty() const { const uint32_t t = best_bid(); return t == NO_PRICE ? 0 : bids_[t].total_qty; }
+    inline uint32_t best_ask_qty() const { const uint32_t t = best_ask(); return t == NO_PRICE ? 0 : asks_[t].total_qty; }
+
+    // Part of that quantity an order of any size can trade against (no minimum fill)
+    inline uint32_t best_bid_free_qty() const { const uint32_t t = best_bid(); return t == NO_PRICE ? 0 : bids_[t].total_qty - bids_[t].min_fill_qty; }
+    inline uint32_t best_ask_free_qty() const { const uint32_t t = best_ask(); return t == NO_PRICE ? 0 : asks_[t].total_qty - asks_[t].min_fill_qty; }
+
+    // Count a fill this book's order got outside the ladder (implied matching) in its stats and profile
+    inline void record_fill(uint32_t tick, uint32_t qty) {
+        ++total_trades_;
+        total_volume_ += qty;
+        profile_.add(tick, qty);
+    }
+
+    // Stats (not atomic since it calls from matching thread)
+    inline uint64_t total_trades() const { return total_trades_; }
+    inline uint64_t total_volume() const { return total_volume_; }
+    inline uint64_t dark_trades() const { return dark_trades_; }
+    inline uint64_t dark_volume() const { return dark_volume_; }
+
+    // Hash of the resting orders (0 for an empty book)
+    inline uint64_t state_hash() const { return state_hash_; }
+
+    // Session traded volume and trade count per tick
+    using Profile = VolumeProfile<MAX_TICKS>;
+    inline const Profile& profile() const { return profile_; }
+
+private:
+    // Book state
+    std::array<PriceLevel, MAX_TICKS> bids_{};
+    std::array<PriceLevel, MAX_TICKS> asks_{};
+    std::array<uint64_t, WORDS> bids_bits_{}; // occupancy bitset by tick
+    std::array<uint64_t, WORDS> asks_bits_{};
+    uint32_t best_bid_{NO_PRICE};
+    uint32_t best_ask_{NO_PRICE};
+    uint32_t compact_cursor_{0};
+
+    // Hidden queues per level; their bits are also set in bids_bits_/asks_bits_
+    std::array<PriceLevel, MAX_TICKS> hidden_bids_{};
+    std::array<PriceLevel, MAX_TICKS> hidden_asks_{};
+    std::array<uint64_t, WORDS> hidden_bids_bits_{};
+    std::array<uint64_t, WORDS> hidden_asks_bits_{};
+    uint32_t hidden_levels_{0}; // non-empty hidden queues
+
+    // Peg queues [side][key] and a bitmask of the non-empty ones per side
+    std::array<std::array<PriceLevel, PEG_KEYS>, 2> pegs_{};
+    std::array<uint32_t, 2> peg_mask_{};
+
+    // Dark midpoint FIFOs per side; set while dark orders wait for a two-sided lit book
+    std::array<PriceLevel, 2> dark_{};
+    bool dark_pending_{false};
+    bool dark_unsettled_{false}; // a fill lowered some order's effective minimum (see match_dark)
+    uint64_t dark_trades_{0};
+    uint64_t dark_volume_{0};
+
+    std::unique_ptr<QueueIndex> queue_; // optional queue-position index
+
+    Pool* pool_{nullptr}; // order nodes & handles (possibly shared)
+    uint16_t book_{0};
+
+    // ---- Stats ----
+    uint64_t total_trades_{0};
+    uint64_t total_volume_{0};
+    uint64_t state_hash_{0}; // XOR of order_key over resting orders
+    Profile profile_;        // volume at price
+
+    inline OrderNode& node(uint32_t idx) { return pool_->node(idx); }
+
+    // Limit order: cross lit levels and peg queues in price order, then rest the remainder
+    inline uint32_t add_lit(const OrderIn& in) {
+        if (unlikely(in.qty == 0 || in.price_tick >= MAX_TICKS)) return NIL;
+
+        const uint32_t min_fill = order_min_fill(in);
+        if (unlikely(min_fill != 0) && !can_fill(in.side, in.price_tick, min_fill)) return NIL;
+
+        uint32_t remaining = in.qty;
+
+        if (in.side == SIDE_BUY) {
+            // Cross against best ask (and sell pegs) while price allows
+            while (remaining) {
+                if (unlikely(peg_mask_[SIDE_SELL] != 0)) {
+                    uint32_t key;
+                    const uint32_t px = best_peg(SIDE_SELL, key);
+                    // pegs trade ahead of lit orders at the same price
+                    if (px != NO_PRICE && px <= in.price_tick && (best_ask_ == NO_PRICE || px <= best_ask_)) {
+                        ENGINE_TALLY(LevelsCrossed, 1);
+                        remaining = match_pegs(SIDE_SELL, key, px, remaining);
+                        continue;
+                    }
+                }
+                if (best_ask_ == NO_PRICE || best_ask_ > in.price_tick) break;
+                uint32_t tick = best_ask_;
+                PriceLevel& lvl = asks_[tick];
+                ENGINE_TALLY(LevelsCrossed, 1);
+
+                if (remaining >= lvl.total_qty) { // sweep takes all displayed quantity
+                    remaining -= lvl.total_qty;
+                    if (lvl.head != NIL) retire_level(lvl, tick);
+                    if (likely(hidden_levels_ == 0) || !test_bit(hidden_asks_bits_, tick)) {
+                        clear_level(asks_bits_, best_ask_, tick);
+                        continue;
+                    }
+                    // hidden orders keep the level: the displayed queue's index restarts here
+                    if (unlikely(queue_ != nullptr)) queue_->clear(SIDE_SELL, tick);
+                }
+
+                if (unlikely(lvl.min_fill_qty != 0)) remaining = match_min_fill(lvl, SIDE_SELL, tick, remaining);
+                else while (remaining && lvl.head != NIL) {
+                    uint32_t idx = lvl.head;
+                    OrderNode& maker = node(idx);
+
+                    uint32_t trade = (remaining < maker.qty) ? remaining : maker.qty;
+                    ENGINE_TALLY(MakersVisited, 1);
+                    toggle_hash(maker);
+                    maker.qty -= trade;
+                    remaining -= trade;
+                    lvl.total_qty -= trade;
+
+                    ++total_trades_;
+                    total_volume_ += trade;
+                    profile_.add(tick, trade);
+                    if (unlikely(queue_ != nullptr)) queue_->reduce(SIDE_SELL, tick, maker.id, trade);
+
+                    if (maker.qty == 0) {
+                        // unlink head
+                        lvl.head = maker.next_idx;
+                        if (lvl.head != NIL) node(lvl.head).prev_idx = NIL; else lvl.tail = NIL;
+                        // retire maker
+                        pool_->release_handle(maker.id);
+                        pool_->free_node(idx);
+                    } else toggle_hash(maker);
+                }
+                // displayed quantity is gone: hidden orders at this price trade next
+                if (unlikely(hidden_levels_ != 0) && remaining && test_bit(hidden_asks_bits_, tick))
+                    remaining = take_hidden(SIDE_SELL, tick, remaining);
+                if (lvl.head == NIL && (likely(hidden_levels_ == 0) || !test_bit(hidden_asks_bits_, tick)))
+                    clear_level(asks_bits_, best_ask_, tick);
+                else {
+                    // only makers this order is too small for are left here: trade past them
+                    if (unlikely(remaining != 0 && lvl.min_fill_qty != 0))
+                        remaining = match_behind(SIDE_SELL, tick, in.price_tick, remaining);
+                    break; // still liquidity at 'tick' but buyer ran out or limit prevents moving on
+                }
+            }
+
+            if (remaining) {
+                // time-in-force
+                if ((in.flags & 0x2u) && remaining != in.qty) { // FOK but partial happened
+                    // roll back is omitted for simplicity. For strict FOK you should prevent partial fill:
+                    // enforce FOK by checking available qty before matching (pre-check by scanning ticks). Skipped here for hot path.
+                }
+                if ((in.flags & 0x1u)) return NIL; // IOC: do not rest
+                // makers this order was too small for are still in reach: resting at its limit
+                // would cross them, so the remainder rests one tick behind them instead
+                uint32_t price = in.price_tick;
+                if (unlikely(best_ask_ != NO_PRICE && best_ask_ <= price)) {
+                    if (best_ask_ == 0) return NIL;
+                    price = best_ask_ - 1u;
+                }
+                return enqueue_resting(SIDE_BUY, price, remaining, in.flags & ORDER_HIDDEN, min_fill);
+            }
+            return DONE_FILL;
+
+        } else { // SELL
+            while (remaining) {
+                if (unlikely(peg_mask_[SIDE_BUY] != 0)) {
+                    uint32_t key;
+                    const uint32_t px = best_peg(SIDE_BUY, key);
+                    if (px != NO_PRICE && px >= in.price_tick && (best_bid_ == NO_PRICE || px >= best_bid_)) {
+                        ENGINE_TALLY(LevelsCrossed, 1);
+                        remaining = match_pegs(SIDE_BUY, key, px, remaining);
+                        continue;
+                    }
+                }
+                if (best_bid_ == NO_PRICE || best_bid_ < in.price_tick) break;
+                uint32_t tick = best_bid_;
+                PriceLevel& lvl = bids_[tick];
+                ENGINE_TALLY(LevelsCrossed, 1);
+
+                if (remaining >= lvl.total_qty) { // sweep takes all displayed quantity
+                    remaining -= lvl.total_qty;
+                    if (lvl.head != NIL) retire_level(lvl, tick);
+                    if (likely(hidden_levels_ == 0) || !test_bit(hidden_bids_bits_, tick)) {
+                        clear_level(bids_bits_, best_bid_, tick);
+                        continue;
+                    }
+                    // hidden orders keep the level: the displayed queue's index restarts here
+                    if (unlikely(queue_ != nullptr)) queue_->clear(SIDE_BUY, tick);
+                }
+
+                if (unlikely(lvl.min_fill_qty != 0)) remaining = match_min_fill(lvl, SIDE_BUY, tick, remaining);
+                else while (remaining && lvl.head != NIL) {
+                    uint32_t idx = lvl.head;
+                    OrderNode& maker = node(idx);
+
+                    uint32_t trade = (remaining < maker.qty) ? remaining : maker.qty;
+                    ENGINE_TALLY(MakersVisited, 1);
+                    toggle_hash(maker);
+                    maker.qty -= trade;
+                    remaining -= trade;
+                    lvl.total_qty -= trade;
+
+                    ++total_trades_;
+                    total_volume_ += trade;
+                    profile_.add(tick, trade);
+                    if (unlikely(queue_ != nullptr)) queue_->reduce(SIDE_BUY, tick, maker.id, trade);
+
+                    if (maker.qty == 0) {
+                        lvl.head = maker.next_idx;
+                        if (lvl.head != NIL) node(lvl.head).prev_idx = NIL; else lvl.tail = NIL;
+                        pool_->release_handle(maker.id);
+                        pool_->free_node(idx);
+                    } else toggle_hash(maker);
+                }
+                if (unlikely(hidden_levels_ != 0) && remaining && test_bit(hidden_bids_bits_, tick))
+                    remaining = take_hidden(SIDE_BUY, tick, remaining);
+                if (lvl.head == NIL && (likely(hidden_levels_ == 0) || !test_bit(hidden_bids_bits_, tick)))
+                    clear_level(bids_bits_, best_bid_, tick);
+                else {
+                    if (unlikely(remaining != 0 && lvl.min_fill_qty != 0))
+                        remaining = match_behind(SIDE_BUY, tick, in.price_tick, remaining);
+                    break;
+                }
+            }
+
+            if (remaining) {
+                if ((in.flags & 0x1u)) return NIL; // IOC
+                uint32_t price = in.price_tick;
+                if (unlikely(best_bid_ != NO_PRICE && best_bid_ >= price)) {
+                    if (best_bid_ + 1u >= MAX_TICKS) return NIL;
+                    price = best_bid_ + 1u;
+                }
+                return enqueue_resting(SIDE_SELL, price, remaining, in.flags & ORDER_HIDDEN, min_fill);
+            }
+            return DONE_FILL;
+        }
+    }
+
+    // Unlink a resting limit order (displayed or hidden) from its level
+    inline void cancel_lit(uint32_t idx) {
+        OrderNode& n = node(idx);
+        const bool hidden = n.flags & NODE_HIDDEN;
+        PriceLevel& lvl = hidden ? level_hidden(n.side, n.price_tick)
+                                 : ((n.side == SIDE_BUY) ? bids_[n.price_tick] : asks_[n.price_tick]);
+
+        // unlink node from intrusive FIFO
+        if (n.prev_idx != NIL) node(n.prev_idx).next_idx = n.next_idx; else lvl.head = n.next_idx;
+        if (n.next_idx != NIL) node(n.next_idx).prev_idx = n.prev_idx; else lvl.tail = n.prev_idx;
+
+        lvl.total_qty = (lvl.head == NIL) ? 0 : (lvl.total_qty - n.qty);
+        if (unlikely(n.flags & NODE_MIN_FILL)) lvl.min_fill_qty -= n.qty;
+        if (unlikely(queue_ != nullptr) && !hidden) queue_->reduce(n.side, n.price_tick, n.id, n.qty);
+
+        if (lvl.head == NIL) {
+            bool empty = true; // both queues at this price
+            if (hidden) {
+                clear_bit(n.side == SIDE_BUY ? hidden_bids_bits_ : hidden_asks_bits_, n.price_tick);
+                --hidden_levels_;
+                empty = ((n.side == SIDE_BUY) ? bids_[n.price_tick] : asks_[n.price_tick]).head == NIL;
+            } else if (unlikely(hidden_levels_ != 0)) {
+                empty = !test_bit(n.side == SIDE_BUY ? hidden_bids_bits_ : hidden_asks_bits_, n.price_tick);
+            }
+            if (empty) {
+                if (n.side == SIDE_BUY) clear_level(bids_bits_, best_bid_, n.price_tick);
+                else                    clear_level(asks_bits_, best_ask_, n.price_tick);
+            }
+        }
+
+        pool_->release_handle(n.id);
+        pool_->free_node(idx);
+    }
+
+    // ---- Hidden and post-only orders ----
+    inline PriceLevel& level_hidden(uint8_t side, uint32_t tick) {
+        return (side == SIDE_BUY) ? hidden_bids_[tick] : hidden_asks_[tick];
+    }
+
+    // Trade against the hidden queue at 'tick' on 'side'. Returns the quantity left
+    inline uint32_t take_hidden(uint8_t side, uint32_t tick, uint32_t remaining) {
+        PriceLevel& h = level_hidden(side, tick);
+        if (remaining >= h.total_qty) {
+            remaining -= h.total_qty;
+            retire_level(h, tick);
+        } else {
+            while (remaining && h.head != NIL) {
+                const uint32_t maker_qty = node(h.head).qty;
+                const uint32_t trade = (remaining < maker_qty) ? remaining : maker_qty;
+                ENGINE_TALLY(MakersVisited, 1);
+                remaining -= trade;
+                ++total_trades_;
+                total_volume_ += trade;
+                profile_.add(tick, trade);
+                consume_head(h, trade);
+            }
+        }
+        if (h.head == NIL) {
+            clear_bit(side == SIDE_BUY ? hidden_bids_bits_ : hidden_asks_bits_, tick);
+            --hidden_levels_;
+        }
+        return remaining;
+    }
+
+    // Best price an incoming order on 'side' could trade at (lit, hidden or peg); NO_PRICE if none
+    inline uint32_t opposite_touch(uint8_t side) const {
+        const uint8_t opp = (side == SIDE_BUY) ? SIDE_SELL : SIDE_BUY;
+        uint32_t touch = (opp == SIDE_SELL) ? best_ask_ : best_bid_;
+        if (unlikely(peg_mask_[opp] != 0)) {
+            uint32_t key;
+            const uint32_t px = best_peg(opp, key);
+            if (px != NO_PRICE && (touch == NO_PRICE || (opp == SIDE_SELL ? px < touch : px > touch))) touch = px;
+        }
+        return touch;
+    }
+
+    // Post-only: never takes liquidity. An order that would cross is rejected, or with
+    // ORDER_POST_SLIDE repriced one tick inside the opposite touch.
+    inline uint32_t add_post_only(const OrderIn& in) {
+        if (unlikely(in.qty == 0 || in.price_tick >= MAX_TICKS || (in.flags & ORDER_IOC))) return NIL;
+        uint32_t price = in.price_tick;
+        const uint32_t touch = opposite_touch(in.side);
+        if (touch != NO_PRICE && (in.side == SIDE_BUY ? touch <= price : touch >= price)) {
+            if (!(in.flags & ORDER_POST_SLIDE)) return NIL;
+            if (in.side == SIDE_BUY) { if (touch == 0) return NIL; price = touch - 1u; }
+            else                     { if (touch + 1u >= MAX_TICKS) return NIL; price = touch + 1u; }
+        }
+        return enqueue_resting(in.side, price, in.qty, in.flags & ORDER_HIDDEN, order_min_fill(in));
+    }
+
+    // First price from the internal best on 'side' with displayed quantity (skips hidden-only levels)
+    inline uint32_t displayed_best(uint8_t side) const {
+        if (side == SIDE_BUY) {
+            uint32_t t = best_bid_;
+            while (t != NO_PRICE && bids_[t].head == NIL) t = (t == 0) ? NO_PRICE : prev_bid_from(t - 1);
+            return t;
+        }
+        uint32_t t = best_ask_;
+        while (t != NO_PRICE && asks_[t].head == NIL) t = next_ask_from(t + 1);
+        return t;
+    }
+
+    // ---- Pegged orders ----
+    // A peg never takes displayed liquidity on entry: a buy peg prices at or below the bid
+    // (primary) or at floor(mid) < ask, so it can only trade hidden orders inside the spread
+    // before joining its queue. Opposite midpoint pegs cross only when the spread is an even
+    // number of ticks; add_limit/cancel_node uncross them afterwards.
+    inline uint32_t add_peg(const OrderIn& in) {
+        if (unlikely(in.qty == 0 || (in.flags & 0x1u))) return NIL; // an IOC peg could never trade
+        uint32_t key;
+        if (in.peg == PEG_MID) key = PEG_KEY_MID;
+        else if (in.peg == PEG_PRIMARY && in.peg_offset < PEG_OFFSETS) key = PEG_KEY_PRIMARY + in.peg_offset;
+        else return NIL;
+        uint32_t remaining = in.qty;
+        if (unlikely(hidden_levels_ != 0)) {
+            const uint32_t px = peg_price(in.side, key);
+            if (px != NO_PRICE) remaining = take_hidden_through(in.side ^ 1, px, remaining);
+            if (remaining == 0) return DONE_FILL;
+        }
+
+        uint32_t idx = pool_->alloc_node();
+        if (unlikely(idx == NIL)) return NIL;
+        OrderNode& n = node(idx);
+        n.price_tick = key;
+        n.qty        = remaining;
+        n.side       = in.side;
+        n.flags      = NODE_PEGGED;
+        n.book       = book_;
+        const uint32_t handle = pool_->assign_handle(idx);
+
+        PriceLevel& q = pegs_[in.side][key];
+        n.prev_idx = q.tail;
+        n.next_idx = NIL;
+        if (q.tail != NIL) node(q.tail).next_idx = idx; else q.head = idx;
+        q.tail = idx;
+        q.total_qty += remaining;
+        peg_mask_[in.side] |= 1u << key;
+        toggle_hash(n);
+        return handle;
+    }
+
+    inline void cancel_peg(uint32_t idx) {
+        OrderNode& n = node(idx);
+        PriceLevel& q = pegs_[n.side][n.price_tick];
+        if (n.prev_idx != NIL) node(n.prev_idx).next_idx = n.next_idx; else q.head = n.next_idx;
+        if (n.next_idx != NIL) node(n.next_idx).prev_idx = n.prev_idx; else q.tail = n.prev_idx;
+        q.total_qty = (q.head == NIL) ? 0 : (q.total_qty - n.qty);
+        if (q.head == NIL) peg_mask_[n.side] &= ~(1u << n.price_tick);
+        pool_->release_handle(n.id);
+        pool_->free_node(idx);
+    }
+
+    // Effective price of peg queue 'key' on 'side' under the current lit BBO (NO_PRICE if unanchored)
+    inline uint32_t peg_price(uint8_t side, uint32_t key) const {
+        const uint32_t bid = best_bid(), ask = best_ask();
+        if (key == PEG_KEY_MID) {
+            if (bid == NO_PRICE || ask == NO_PRICE) return NO_PRICE;
+            const uint32_t sum = bid + ask;
+            return side == SIDE_BUY ? sum / 2 : (sum + 1) / 2; // half-tick mids round passive
+        }
+        const uint32_t off = key - PEG_KEY_PRIMARY;
+        if (side == SIDE_BUY) return (bid == NO_PRICE || bid < off) ? NO_PRICE : bid - off;
+        return (ask == NO_PRICE || ask + off >= MAX_TICKS) ? NO_PRICE : ask + off;
+    }
+
+    // Most aggressive anchored peg queue on 'side' (O(PEG_KEYS)); NO_PRICE (and key 0) if none
+    inline uint32_t best_peg(uint8_t side, uint32_t& key) const {
+        uint32_t best = NO_PRICE;
+        key = PEG_KEY_MID;
+        for (uint32_t m = peg_mask_[side]; m; m &= m - 1) {
+            const uint32_t k = std::countr_zero(m);
+            const uint32_t px = peg_price(side, k);
+            if (px == NO_PRICE) continue;
+            if (best == NO_PRICE || (side == SIDE_BUY ? px > best : px < best)) { best = px; key = k; }
+        }
+        return best;
+    }
+
+    // Fill 'trade' off the head of queue/level 'q'; retires the head once empty
+    inline void consume_head(PriceLevel& q, uint32_t trade) {
+        const uint32_t idx = q.head;
+        OrderNode& maker = node(idx);
+        toggle_hash(maker);
+        maker.qty -= trade;
+        q.total_qty -= trade;
+        if (maker.qty == 0) {
+            q.head = maker.next_idx;
+            if (q.head != NIL) node(q.head).prev_idx = NIL; else q.tail = NIL;
+            pool_->release_handle(maker.id);
+            pool_->free_node(idx);
+        } else toggle_hash(maker);
+    }
+
+    // Take liquidity from peg queue 'key' on 'side', priced at 'px'. Returns the quantity left
+    inline uint32_t match_pegs(uint8_t side, uint32_t key, uint32_t px, uint32_t remaining) {
+        PriceLevel& q = pegs_[side][key];
+        while (remaining && q.head != NIL) {
+            const uint32_t maker_qty = node(q.head).qty;
+            const uint32_t trade = (remaining < maker_qty) ? remaining : maker_qty;
+            ENGINE_TALLY(MakersVisited, 1);
+            remaining -= trade;
+            ++total_trades_;
+            total_volume_ += trade;
+            profile_.add(px, trade);
+            consume_head(q, trade);
+        }
+        if (q.head == NIL) peg_mask_[side] &= ~(1u << key);
+        return remaining;
+    }
+
+    // Buy and sell midpoint pegs meet at the mid when the spread is even: trade them out
+    void uncross_mid_pegs() {
+        const uint32_t bid = best_bid(), ask = best_ask();
+        if (bid == NO_PRICE || ask == NO_PRICE || ((bid + ask) & 1u)) return;
+        PriceLevel& b = pegs_[SIDE_BUY][PEG_KEY_MID];
+        PriceLevel& s = pegs_[SIDE_SELL][PEG_KEY_MID];
+        while (b.head != NIL && s.head != NIL) {
+            const uint32_t bq = node(b.head).qty, sq = node(s.head).qty;
+            const uint32_t trade = bq < sq ? bq : sq;
+            ++total_trades_;
+            total_volume_ += trade;
+            profile_.add((bid + ask) / 2, trade);
+            consume_head(b, trade);
+            consume_head(s, trade);
+        }
+        if (b.head == NIL) peg_mask_[SIDE_BUY] &= ~(1u << PEG_KEY_MID);
+        if (s.head == NIL) peg_mask_[SIDE_SELL] &= ~(1u << PEG_KEY_MID);
+    }
+
+    // Pegs are priced from the displayed BBO, so a peg can reach a hidden level inside the spread.
+    // Take hidden liquidity on 'opp' at or through 'px' (at each level's own price), stopping at
+    // the first displayed level. Returns the quantity left
+    inline uint32_t take_hidden_through(uint8_t opp, uint32_t px, uint32_t remaining) {
+        auto& bits = opp == SIDE_SELL ? asks_bits_ : bids_bits_;
+        auto& hbits = opp == SIDE_SELL ? hidden_asks_bits_ : hidden_bids_bits_;
+        uint32_t& best = opp == SIDE_SELL ? best_ask_ : best_bid_;
+        while (remaining && best != NO_PRICE && (opp == SIDE_SELL ? best <= px : best >= px)) {
+            const uint32_t tick = best;
+            if ((opp == SIDE_SELL ? asks_[tick] : bids_[tick]).head != NIL || !test_bit(hbits, tick)) break;
+            remaining = take_hidden(opp, tick, remaining);
+            if (!test_bit(hbits, tick)) clear_level(bits, best, tick);
+        }
+        return remaining;
+    }
+
+    // A lit add or cancel moves the BBO and reprices resting pegs: trade out any that now reach a
+    // hidden level, as a peg arriving at that price would have
+    void uncross_hidden_pegs() {
+        for (uint8_t side = SIDE_BUY; side <= SIDE_SELL; ++side) {
+            while (peg_mask_[side] != 0 && hidden_levels_ != 0) {
+                uint32_t key;
+                const uint32_t px = best_peg(side, key);
+                if (px == NO_PRICE) break;
+                PriceLevel& q = pegs_[side][key];
+                const uint32_t want = node(q.head).qty;
+                const uint32_t left = take_hidden_through(side ^ 1, px, want);
+                if (left == want) break;
+                consume_head(q, want - left);
+                if (q.head == NIL) peg_mask_[side] &= ~(1u << key);
+            }
+        }
+    }
+
+    // ---- All-or-none and minimum-quantity orders ----
+    // Minimum fill an incoming order asks for (AON: its whole size); hidden orders take none
+    static inline uint32_t order_min_fill(const OrderIn& in) {
+        if (likely(in.min_qty == 0 && !(in.flags & ORDER_AON)) || (in.flags & ORDER_HIDDEN)) return 0;
+        return (in.flags & ORDER_AON) || in.min_qty > in.qty ? in.qty : in.min_qty;
+    }
+
+    // Smallest trade the resting order 'n' (NODE_MIN_FILL) accepts now
+    inline uint32_t maker_min_fill(const OrderNode& n) const {
+        const uint32_t m = pool_->min_fill(n.id);
+        return m < n.qty ? m : n.qty;
+    }
+
+    // Taker side: an order that would cross must be able to trade at least 'need' on entry,
+    // counted conservatively over displayed makers without a minimum of their own. One that
+    // cannot is rejected rather than left resting through the touch.
+    bool can_fill(uint8_t side, uint32_t limit, uint32_t need) const {
+        const uint32_t touch = opposite_touch(side);
+        if (touch == NO_PRICE || (side == SIDE_BUY ? touch > limit : touch < limit)) return true;
+        uint32_t free = 0;
+        if (side == SIDE_BUY) {
+            for (uint32_t t = best_ask_; t != NO_PRICE && t <= limit && free < need; t = next_ask_from(t + 1))
+                free += asks_[t].total_qty - asks_[t].min_fill_qty;
+        } else {
+            for (uint32_t t = best_bid_; t != NO_PRICE && t >= limit && free < need; t = (t == 0) ? NO_PRICE : prev_bid_from(t - 1))
+                free += bids_[t].total_qty - bids_[t].min_fill_qty;
+        }
+        return free >= need;
+    }
+
+    // Trade against a level that holds minimum-fill makers in time priority, passing over each
+    // one this trade is too small for. Returns the quantity left
+    uint32_t match_min_fill(PriceLevel& lvl, uint8_t side, uint32_t tick, uint32_t remaining) {
+        for (uint32_t idx = lvl.head; idx != NIL && remaining != 0;) {
+            OrderNode& maker = node(idx);
+            const uint32_t next = maker.next_idx;
+            const uint32_t trade = (remaining < maker.qty) ? remaining : maker.qty;
+            const bool constrained = maker.flags & NODE_MIN_FILL;
+            ENGINE_TALLY(MakersVisited, 1);
+            if (constrained && trade < maker_min_fill(maker)) { idx = next; continue; }
+
+            toggle_hash(maker);
+            maker.qty -= trade;
+            remaining -= trade;
+            lvl.total_qty -= trade;
+            if (constrained) lvl.min_fill_qty -= trade;
+            ++total_trades_;
+            total_volume_ += trade;
+            profile_.add(tick, trade);
+            if (unlikely(queue_ != nullptr)) queue_->reduce(side, tick, maker.id, trade);
+
+            if (maker.qty == 0) {
+                if (maker.prev_idx != NIL) node(maker.prev_idx).next_idx = next; else lvl.head = next;
+                if (next != NIL) node(next).prev_idx = maker.prev_idx; else lvl.tail = maker.prev_idx;
+                pool_->release_handle(maker.id);
+                pool_->free_node(idx);
+            } else toggle_hash(maker);
+            idx = next;
+        }
+        return remaining;
+    }
+
+    // The level at 'from' (the touch on 'side') is left holding only makers the incoming order
+    // is too small for: keep crossing the levels behind it, and any peg priced in between, up
+    // to 'limit'. The touch itself stays put. Returns the quantity left
+    uint32_t match_behind(uint8_t side, uint32_t from, uint32_t limit, uint32_t remaining) {
+        const bool sell = side == SIDE_SELL;
+        auto& bits = sell ? asks_bits_ : bids_bits_;
+        auto& hbits = sell ? hidden_asks_bits_ : hidden_bids_bits_;
+        for (uint32_t tick = from; remaining != 0;) {
+            tick = sell ? next_ask_from(tick + 1) : (tick == 0 ? NO_PRICE : prev_bid_from(tick - 1));
+            while (unlikely(peg_mask_[side] != 0) && remaining != 0) {
+                uint32_t key;
+                const uint32_t px = best_peg(side, key);
+                if (px == NO_PRICE || (sell ? px > limit : px < limit)) break;
+                if (tick != NO_PRICE && (sell ? px > tick : px < tick)) break;
+                ENGINE_TALLY(LevelsCrossed, 1);
+                remaining = match_pegs(side, key, px, remaining);
+            }
+            if (remaining == 0 || tick == NO_PRICE || (sell ? tick > limit : tick < limit)) break;
+
+            PriceLevel& lvl = sell ? asks_[tick] : bids_[tick];
+            ENGINE_TALLY(LevelsCrossed, 1);
+            if (lvl.head != NIL) remaining = match_min_fill(lvl, side, tick, remaining);
+            if (unlikely(hidden_levels_ != 0) && remaining && test_bit(hbits, tick))
+                remaining = take_hidden(side, tick, remaining);
+            if (lvl.head == NIL && (likely(hidden_levels_ == 0) || !test_bit(hbits, tick)))
+                clear_level(bits, sell ? best_ask_ : best_bid_, tick);
+        }
+        return remaining;
+    }
+
+    // ---- Dark midpoint book ----
+    static inline uint32_t min_fill(const OrderNode& n) { return n.price_tick < n.qty ? n.price_tick : n.qty; }
+
+    inline bool has_mid() const { return best_bid() != NO_PRICE && best_ask() != NO_PRICE; }
+
+    // Rest a dark order, crossing it first with the opposite dark FIFO if there is a midpoint
+    inline uint32_t add_dark(const OrderIn& in) {
+        if (unlikely(in.qty == 0 || (in.flags & (ORDER_IOC | ORDER_FOK)))) return NIL;
+        if (unlikely(dark_pending_)) cross_dark(); // earlier arrivals keep time priority
+        uint32_t idx = pool_->alloc_node();
+        if (unlikely(idx == NIL)) return NIL;
+        OrderNode& n = node(idx);
+        n.price_tick = in.min_qty; // minimum fill
+        n.qty        = in.qty;
+        n.side       = in.side;
+        n.flags      = NODE_DARK;
+        n.book       = book_;
+        const uint32_t handle = pool_->assign_handle(idx);
+
+        bool settle = false; // a partial fill lowered someone's minimum: more pairs may fit now
+        if (has_mid()) {
+            dark_unsettled_ = false;
+            const uint32_t left = match_dark(idx);
+            settle = dark_unsettled_;
+            if (left == 0) {
+                pool_->release_handle(handle);
+                pool_->free_node(idx);
+                if (unlikely(settle)) cross_dark();
+                return DONE_FILL;
+            }
+        } else if (dark_[in.side ^ 1].head != NIL) {
+            dark_pending_ = true;
+        }
+
+        PriceLevel& q = dark_[in.side];
+        n.prev_idx = q.tail;
+        n.next_idx = NIL;
+        if (q.tail != NIL) node(q.tail).next_idx = idx; else q.head = idx;
+        q.tail = idx;
+        q.total_qty += n.qty;
+        toggle_hash(n);
+        if (unlikely(settle)) cross_dark();
+        return handle;
+    }
+
+    // Trade the order at 'idx' (not queued) against the opposite dark FIFO in time priority,
+    // skipping orders whose minimum fill either side cannot meet. Returns its quantity left.
+    inline uint32_t match_dark(uint32_t idx) {
+        OrderNode& t = node(idx);
+        const uint32_t mid = (best_bid() + best_ask()) / 2;
+        for (uint32_t o = dark_[t.side ^ 1].head; o != NIL && t.qty != 0;) {
+            OrderNode& m = node(o);
+            const uint32_t next = m.next_idx;
+            const uint32_t trade = t.qty < m.qty ? t.qty : m.qty;
+            if (trade >= min_fill(t) && trade >= min_fill(m)) {
+                toggle_hash(m);
+                t.qty -= trade;
+                m.qty -= trade;
+                if (m.qty != 0) toggle_hash(m);
+                dark_[m.side].total_qty -= trade;
+                ++total_trades_;
+                total_volume_ += trade;
+                ++dark_trades_;
+                dark_volume_ += trade;
+                profile_.add(mid, trade);
+                // a part-filled order with a minimum above its remainder now accepts smaller fills
+                if ((m.qty != 0 && m.price_tick > m.qty) || (t.qty != 0 && t.price_tick > t.qty)) dark_unsettled_ = true;
+                if (m.qty == 0) remove_dark(o);
+            }
+            o = next;
+        }
+        return t.qty;
+    }
+
+    inline void remove_dark(uint32_t idx) {
+        OrderNode& n = node(idx);
+        PriceLevel& q = dark_[n.side];
+        if (n.prev_idx != NIL) node(n.prev_idx).next_idx = n.next_idx; else q.head = n.next_idx;
+        if (n.next_idx != NIL) node(n.next_idx).prev_idx = n.prev_idx; else q.tail = n.prev_idx;
+        q.total_qty = (q.head == NIL) ? 0 : (q.total_qty - n.qty);
+        pool_->release_handle(n.id);
+        pool_->free_node(idx);
+    }
+
+    // Cross the resting dark orders with each other in time priority until no pair fits: after
+    // the lit book regains a midpoint, or after a partial fill lowered an order's effective
+    // minimum. O(buys x sells) per pass, and only minimum-fill orders ever need a second pass.
+    void cross_dark() {
+        if (!has_mid()) return;
+        dark_pending_ = false;
+        for (bool again = true; again;) {
+            bool traded = false;
+            dark_unsettled_ = false;
+            for (uint32_t b = dark_[SIDE_BUY].head; b != NIL && dark_[SIDE_SELL].head != NIL;) {
+                const uint32_t next = node(b).next_idx;
+                const uint32_t before = node(b).qty;
+                toggle_hash(node(b)); // 'b' trades as the arriving side: rehash it afterwards
+                const uint32_t left = match_dark(b);
+                if (left != 0) toggle_hash(node(b));
+                dark_[SIDE_BUY].total_qty -= before - left;
+                if (left != before) traded = true;
+                if (left == 0) remove_dark(b);
+                b = next;
+            }
+            again = traded && dark_unsettled_;
+        }
+    }
+
+    // ---- State hash ----
+    static inline uint64_t mix64(uint64_t x) { // splitmix64 finaliser
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+        return x ^ (x >> 31);
+    }
+    // Key of one resting order: handle, price (or peg key / dark minimum), remaining qty, kind, side
+    static inline uint64_t order_key(const OrderNode& n) {
+        return mix64(mix64(((uint64_t)n.id << 32) | n.price_tick) ^ (((uint64_t)n.qty << 16) | ((uint32_t)n.flags << 8) | n.side));
+    }
+    // XOR an order in or out of the hash; around a size change, out before and in after
+    inline void toggle_hash(const OrderNode& n) { state_hash_ ^= order_key(n); }
+
+    // ---- Bitset helpers ----
+    static inline void set_bit(std::array<uint64_t, WORDS>& bits, uint32_t tick) {
+        bits[tick / WORD_BITS] |= (uint64_t(1) << (tick % WORD_BITS));
+    }
+    static inline void clear_bit(std::array<uint64_t, WORDS>& bits, uint32_t tick) {
+        bits[tick / WORD_BITS] &= ~(uint64_t(1) << (tick % WORD_BITS));
+    }
+    static inline bool test_bit(const std::array<uint64_t, WORDS>& bits, uint32_t tick) {
+        return (bits[tick / WORD_BITS] >> (tick % WORD_BITS)) & 1u;
+    }
+
+    // Find next ask >= 'from'
+    inline uint32_t next_ask_from(uint32_t from) const {
+        uint32_t w = from / WORD_BITS;
+        uint32_t b = from % WORD_BITS;
+        if (w >= WORDS) return NO_PRICE;
+
+        uint64_t word = asks_bits_[w] & (~0ull << b);
+        if (word) {
+            ENGINE_SAMPLE(WordsScanned, 1);
+            return w * WORD_BITS + std::countr_zero(word);
+        }
+
+        for (++w; w < WORDS; ++w)
+            if (asks_bits_[w]) {
+                ENGINE_SAMPLE(WordsScanned, w - from / WORD_BITS + 1u);
+                return w * WORD_BITS + std::countr_zero(asks_bits_[w]);
+            }
+        ENGINE_SAMPLE(WordsScanned, WORDS - from / WORD_BITS);
+        return NO_PRICE;
+    }
+
+    // Find prev bid <= 'from'
+    inline uint32_t prev_bid_from(uint32_t from) const {
+        uint32_t w = from / WORD_BITS;
+        uint32_t b = from % WORD_BITS;
+        if (w >= WORDS) return NO_PRICE;
+
+        const uint64_t mask = (b == 63) ? ~0ull : ((uint64_t(1) << (b + 1)) - 1ull);
+        uint64_t word = bids_bits_[w] & mask;
+        if (word) {
+            ENGINE_SAMPLE(WordsScanned, 1);
+            return w * WORD_BITS + (63u - std::countl_zero(word));
+        }
+
+        while (w--) {
+            if (bids_bits_[w]) {
+                ENGINE_SAMPLE(WordsScanned, from / WORD_BITS - w + 1u);
+                return w * WORD_BITS + (63u - std::countl_zero(bids_bits_[w]));
+            }
+            if (w == 0) break;
+        }
+        ENGINE_SAMPLE(WordsScanned, from / WORD_BITS + 1u);
+        return NO_PRICE;
+    }
+
+    // Fill every maker on a level at once: release their handles, then splice the whole
+    // FIFO onto the pool free list without unlinking node by node. Still O(makers): each one
+    // is visited once for its handle and hash key, but without the per-node unlink, quantity
+    // and free-list writes (bench/sweep_bench measures both parts)
+    inline void retire_level(PriceLevel& lvl, uint32_t tick) {
+        uint32_t makers = 0;
+        for (uint32_t idx = lvl.head; idx != NIL; idx = node(idx).next_idx) {
+            toggle_hash(node(idx));
+            pool_->release_handle(node(idx).id);
+            ++makers;
+        }
+        ENGINE_TALLY(MakersVisited, makers);
+        total_trades_ += makers;
+        total_volume_ += lvl.total_qty;
+        profile_.add(tick, lvl.total_qty, makers);
+        pool_->free_chain(lvl.head, lvl.tail, makers);
+        lvl = PriceLevel{};
+    }
+
+    // k-th occupied level from the touch (k = 0 is the best price)
+    inline uint32_t nth_level(bool buy, uint32_t k) const {
+        uint32_t tick = buy ? best_bid_ : best_ask_;
+        while (k-- && tick != NO_PRICE) {
+            if (buy) tick = (tick == 0) ? NO_PRICE : prev_bid_from(tick - 1);
+            else     tick = next_ask_from(tick + 1);
+        }
+        return tick;
+    }
+
+    // Move part of one level's FIFO into a run of free nodes. The FIFO is walked past the prefix
+    // already laid out in runs of at least COMPACT_MIN_RUN nodes, then up to 'budget' nodes from
+    // there are moved into one run, so repeated visits work down a long level chunk by chunk.
+    static constexpr uint32_t COMPACT_MIN_RUN = 16;
+
+    inline uint32_t compact_level(PriceLevel& lvl, uint32_t budget) {
+        if (budget < COMPACT_MIN_RUN) return 0;
+
+        // find the first run that is too short and does not end the FIFO
+        uint32_t before = NIL, start = lvl.head;
+        for (;;) {
+            if (start == NIL) return 0;
+            uint32_t len = 1, last = start;
+            while (node(last).next_idx == last + 1u) { last = last + 1u; ++len; }
+            const uint32_t after = node(last).next_idx;
+            if (after == NIL) return 0; // the rest is one run already
+            if (len < COMPACT_MIN_RUN) break;
+            before = last;
+            start = after;
+        }
+
+        uint32_t count = 0, stop = start; // 'stop': first node left in place
+        while (stop != NIL && count < budget) { stop = node(stop).next_idx; ++count; }
+
+        const uint32_t dst = pool_->find_free_run(count, count * 16u);
+        if (dst == NIL) return 0;
+
+        uint32_t prev = before;
+        for (uint32_t idx = start, k = 0; idx != stop; ++k) {
+            const uint32_t next = node(idx).next_idx;
+            const uint32_t to = dst + k;
+            pool_->take_free(to);
+            OrderNode& n = node(to);
+            n = node(idx);
+            n.prev_idx = prev;
+            n.next_idx = (next == stop) ? stop : to + 1u;
+            pool_->rebind_handle(n.id, to);
+            pool_->free_node(idx);
+            prev = to;
+            idx = next;
+        }
+        if (before != NIL) node(before).next_idx = dst; else lvl.head = dst;
+        if (stop != NIL) node(stop).prev_idx = prev; else lvl.tail = prev;
+        return count;
+    }
+
+    // Maintain best pointers after a level empties
+    inline void clear_level(std::array<uint64_t, WORDS>& bits, uint32_t& best, uint32_t emptied_tick) {
+        clear_bit(bits, emptied_tick);
+        if (unlikely(queue_ != nullptr)) queue_->clear(&bits == &bids_bits_ ? SIDE_BUY : SIDE_SELL, emptied_tick);
+        if (&bits == &bids_bits_) {
+            if (emptied_tick == best) best = (emptied_tick == 0) ? prev_bid_from(0) : prev_bid_from(emptied_tick - 1);
+        } else {
+            if (emptied_tick == best) best = next_ask_from(emptied_tick + 1);
+        }
+    }
+
+    // Ensure best pointers after adding liquidity
+    inline void ensure_best_after_add(uint8_t side, uint32_t tick) {
+        if (side == SIDE_BUY) {
+            if (best_bid_ == NO_PRICE || tick > best_bid_) best_bid_ = tick;
+        } else {
+            if (best_ask_ == NO_PRICE || tick < best_ask_) best_ask_ = tick;
+        }
+    }
+
+    // Enqueue a resting order at tail of its level (or its hidden queue). returns handle
+    inline uint32_t enqueue_resting(uint8_t side, uint32_t price_tick, uint32_t qty, bool hidden = false, uint32_t min_fill = 0) {
+        uint32_t idx = pool_->alloc_node();
+        if (unlikely(idx == NIL)) return NIL;
+
+        OrderNode& n = node(idx);
+        n.price_tick = price_tick;
+        n.qty        = qty;
+        n.side       = side;
+        n.flags      = hidden ? NODE_HIDDEN : 0;
+        n.book       = book_;
+
+        const uint32_t handle = pool_->assign_handle(idx);
+        if (unlikely(min_fill != 0)) {
+            n.flags = NODE_MIN_FILL;
+            pool_->set_min_fill(handle, min_fill);
+        }
+
+        if (unlikely(hidden)) {
+            auto& hbits = (side == SIDE_BUY) ? hidden_bids_bits_ : hidden_asks_bits_;
+            if (!test_bit(hbits, price_tick)) { set_bit(hbits, price_tick); ++hidden_levels_; }
+        }
+        PriceLevel& lvl = hidden ? level_hidden(side, price_tick)
+                                 : ((side == SIDE_BUY) ? bids_[price_tick] : asks_[price_tick]);
+
+        // append to tail (FIFO price-time priority)
+        n.prev_idx = lvl.tail;
+        n.next_idx = NIL;
+        if (lvl.tail != NIL) node(lvl.tail).next_idx = idx; else lvl.head = idx;
+        lvl.tail = idx;
+        lvl.total_qty += qty;
+        if (unlikely(min_fill != 0)) lvl.min_fill_qty += qty;
+        toggle_hash(n);
+        if (unlikely(queue_ != nullptr) && !hidden) queue_->rest(side, price_tick, handle, qty);
+
+        // mark occupancy & adjust best
+        if (side == SIDE_BUY) {
+            if (!test_bit(bids_bits_, price_tick)) set_bit(bids_bits_, price_tick);
+            ensure_best_after_add(SIDE_BUY, price_tick);
+        } else {
+            if (!test_bit(asks_bits_, price_tick)) set_bit(asks_bits_, price_tick);
+            ensure_best_after_add(SIDE_SELL, price_tick);
+        }
+        return handle;
+    }
+};
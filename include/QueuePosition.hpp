@@ -0,0 +1,109 @@
+// QueuePosition.hpp
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Per-level order statistics: quantity resting ahead of an order in O(log n).
+// Each price level numbers its orders by arrival slot and keeps a Fenwick tree of remaining
+// quantity over those slots; queue-ahead for an order is the prefix sum before its slot.
+// Fills and cancels are point updates. When a level runs out of slots its live orders are
+// renumbered in FIFO order, and an emptied level starts again from slot 0.
+template <uint32_t MAX_TICKS>
+class QueuePositionIndex {
+public:
+    static constexpr uint32_t MIN_SLOTS = 64;
+
+    void reset() {
+        for (Level& l : levels_) l.clear();
+    }
+
+    // A new order rests at the tail of (side, tick)
+    inline void rest(uint8_t side, uint32_t tick, uint32_t handle, uint32_t qty) {
+        Level& l = level(side, tick);
+        if (l.next == l.qty.size()) make_room(l);
+        const uint32_t slot = l.next++;
+        l.qty[slot] = qty;
+        l.handle[slot] = handle;
+        l.add(slot, (int64_t)qty);
+        ++l.live;
+        if (handle >= slot_of_.size()) slot_of_.resize(handle + 1 > slot_of_.size() * 2 ? handle + 1 : slot_of_.size() * 2);
+        slot_of_[handle] = slot;
+    }
+
+    // 'qty' traded or cancelled off a resting order
+    inline void reduce(uint8_t side, uint32_t tick, uint32_t handle, uint32_t qty) {
+        Level& l = level(side, tick);
+        const uint32_t slot = slot_of_[handle];
+        l.qty[slot] -= qty;
+        l.add(slot, -(int64_t)qty);
+        if (l.qty[slot] == 0) --l.live;
+    }
+
+    // Level emptied (swept or last order cancelled)
+    inline void clear(uint8_t side, uint32_t tick) { level(side, tick).clear(); }
+
+    // Quantity resting ahead of 'handle' at (side, tick)
+    inline uint64_t ahead(uint8_t side, uint32_t tick, uint32_t handle) const {
+        const Level& l = levels_[side * MAX_TICKS + tick];
+        return l.prefix(slot_of_[handle]);
+    }
+
+private:
+    struct Level {
+        std::vector<uint32_t> qty;    // remaining quantity by arrival slot
+        std::vector<uint32_t> handle; // order in each slot
+        std::vector<int64_t>  tree;   // Fenwick tree over qty (1-based)
+        uint32_t next = 0;            // next arrival slot
+        uint32_t live = 0;            // slots with qty > 0
+
+        inline void add(uint32_t slot, int64_t delta) {
+            for (size_t i = slot + 1; i < tree.size(); i += i & (~i + 1)) tree[i] += delta;
+        }
+        // sum of qty over slots [0, slot)
+        inline uint64_t prefix(uint32_t slot) const {
+            int64_t s = 0;
+            for (size_t i = slot; i > 0; i -= i & (~i + 1)) s += tree[i];
+            return (uint64_t)s;
+        }
+        void clear() {
+            for (uint32_t i = 0; i < next; ++i) qty[i] = 0;
+            for (size_t i = 0; i < tree.size(); ++i) tree[i] = 0;
+            next = 0;
+            live = 0;
+        }
+    };
+
+    std::vector<Level> levels_ = std::vector<Level>(2 * MAX_TICKS); // [side][tick]
+    std::vector<uint32_t> slot_of_;                                 // handle -> slot at its level
+
+    inline Level& level(uint8_t side, uint32_t tick) { return levels_[side * MAX_TICKS + tick]; }
+
+    // Out of slots: renumber live orders from 0 (keeping FIFO order), doubling the
+    // capacity first if the level is more than half live, then rebuild the tree in O(n)
+    void make_room(Level& l) {
+        size_t cap = l.qty.size();
+        if (cap == 0) cap = MIN_SLOTS;
+        else if ((size_t)l.live * 2 > cap) cap *= 2;
+
+        uint32_t n = 0;
+        for (uint32_t s = 0; s < l.next; ++s) {
+            if (l.qty[s] == 0) continue;
+            l.qty[n] = l.qty[s];
+            l.handle[n] = l.handle[s];
+            slot_of_[l.handle[n]] = n;
+            ++n;
+        }
+        l.qty.resize(cap);
+        l.handle.resize(cap);
+        for (size_t s = n; s < cap; ++s) l.qty[s] = 0;
+        l.next = n;
+
+        l.tree.assign(cap + 1, 0);
+        for (size_t i = 1; i <= cap; ++i) {
+            l.tree[i] += l.qty[i - 1];
+            const size_t parent = i + (i & (~i + 1));
+            if (parent <= cap) l.tree[parent] += l.tree[i];
+        }
+    }
+};
@@ -0,0 +1,38 @@
+#pragma once
+#include <atomic>
+#include <vector>
+#include "Config.hpp"
+#include "InstrumentBook.hpp"
+#include "Stats.hpp"
+
+// Thread-per-core (shard-per-core) layout. Each shard owns the instruments placed on it,
+// reads its own ingress (a local OrderFlow here; a socket or replay in production), matches
+// and accounts locally. Nothing crosses threads on the common path: no ring, no handoff.
+class ReactorShard
+{
+public:
+    ReactorShard(uint32_t id,
+                 uint32_t num_shards,
+                 InstrumentDirectory *dir, // nullptr: host books in one shared-pool EngineGroup
+                 const Config &cfg,
+                 Stats &stats);
+
+    void operator()(); // thread entry
+
+    // Messages this shard generates so that all shards together produce cfg.num_orders
+    static uint64_t shardOrders(const Config &cfg, uint32_t shard, uint32_t num_shards);
+
+private:
+    uint32_t id_;
+    uint32_t num_shards_;
+    InstrumentDirectory *dir_;
+    const Config &cfg_;
+    Stats &stats_;
+
+    template <typename ApplyFn>
+    void run(const std::vector<uint32_t> &owned, uint64_t count, MatchCounters &local, ApplyFn &&apply);
+    void flush(MatchCounters &local);
+};
+
+// Run the whole flow through 'num_shards' reactor shards (timed into 'stats')
+void runReactor(const Config &cfg, Stats &stats, int num_shards);
@@ -0,0 +1,29 @@
+#pragma once
+#include <atomic>
+#include <vector>
+#include "Config.hpp"
+#include "InstrumentBook.hpp"
+#include "Stats.hpp"
+
+// Watches per-instrument offered message rates and moves an instrument from the busiest worker to the
+// idlest one when the spread exceeds Config::rebalance_threshold. One migration in flight at a time.
+class RebalanceController
+{
+public:
+    RebalanceController(InstrumentDirectory &dir,
+                        const Config &cfg,
+                        std::atomic<bool> &done_flag,
+                        Stats &stats);
+
+    void operator()(); // thread entry
+
+private:
+    InstrumentDirectory &dir_;
+    const Config cfg_;
+    std::atomic<bool> &done_;
+    Stats &stats_;
+
+    // Controller's view of the routing table (it is the only one issuing moves)
+    std::vector<uint32_t> assignment_;
+    std::vector<uint64_t> last_msgs_;
+};
@@ -7,6 +7,8 @@
 #include <vector>
 #include <algorithm>
 #include <memory>
+#include <mutex>
+#include <bit>
 
 // Helper function to add commas to large numbers
 inline std::string formatNumber(uint64_t num)
@@ -39,6 +41,100 @@ inline std::string formatBytes(size_t bytes)
     return std::string(buffer);
 }
 
+// Log-linear histogram: 4 sub-buckets per power of two (~19% resolution).
+// Not thread-safe; each thread records locally and merges at the end.
+struct Log2Histogram
+{
+    static constexpr uint32_t SUB_BITS = 2;
+    static constexpr uint32_t BUCKETS = 64 << SUB_BITS;
+
+    uint64_t buckets[BUCKETS]{};
+    uint64_t count{0};
+    uint64_t sum{0};
+    uint64_t max{0};
+
+    static inline uint32_t bucketOf(uint64_t v)
+    {
+        if (v < (1u << SUB_BITS))
+            return (uint32_t)v;
+        const uint32_t msb = 63u - std::countl_zero(v);
+        const uint32_t sub = (uint32_t)(v >> (msb - SUB_BITS)) & ((1u << SUB_BITS) - 1u);
+        return ((msb - SUB_BITS + 1u) << SUB_BITS) + sub;
+    }
+    static inline uint64_t bucketLow(uint32_t b)
+    {
+        if (b < (1u << SUB_BITS))
+            return b;
+        const uint32_t msb = (b >> SUB_BITS) + SUB_BITS - 1u;
+        const uint64_t sub = b & ((1u << SUB_BITS) - 1u);
+        return (uint64_t(1) << msb) | (sub << (msb - SUB_BITS));
+    }
+
+    inline void record(uint64_t v)
+    {
+        ++buckets[bucketOf(v)];
+        ++count;
+        sum += v;
+        if (v > max)
+            max = v;
+    }
+
+    void merge(const Log2Histogram &o)
+    {
+        for (uint32_t i = 0; i < BUCKETS; ++i)
+            buckets[i] += o.buckets[i];
+        count += o.count;
+        sum += o.sum;
+        if (o.max > max)
+            max = o.max;
+    }
+
+    // Lower bound of the bucket holding the p-th percentile (p in 0..100)
+    uint64_t percentile(double p) const
+    {
+        if (count == 0)
+            return 0;
+        uint64_t rank = (uint64_t)(count * p / 100.0);
+        if (rank >= count)
+            rank = count - 1;
+        uint64_t seen = 0;
+        for (uint32_t i = 0; i < BUCKETS; ++i)
+        {
+            seen += buckets[i];
+            if (seen > rank)
+                return bucketLow(i);
+        }
+        return max;
+    }
+
+    uint64_t mean() const { return count ? sum / count : 0; }
+};
+
+// Sampled per-stage pipeline latency (nanoseconds)
+struct StageLatency
+{
+    enum Stage
+    {
+        PUSH_WAIT = 0, // generated -> pushed into ring (producer backpressure)
+        QUEUEING,      // pushed -> popped by worker
+        BATCH_WAIT,    // popped -> match start (waiting behind the rest of the batch)
+        ENGINE,        // match start -> match end
+        END_TO_END,    // generated -> match end
+        CANCEL_ACK,    // cancel generated -> applied (every cancel, not sampled)
+        NUM_STAGES
+    };
+    static constexpr const char *names[NUM_STAGES] = {"Push Wait", "Queueing", "Batch Wait", "Engine", "End-to-End",
+                                                      "Cancel->Ack"};
+
+    Log2Histogram stages[NUM_STAGES];
+
+    void merge(const StageLatency &o)
+    {
+        for (int i = 0; i < NUM_STAGES; ++i)
+            stages[i].merge(o.stages[i]);
+    }
+};
+
 struct AdvancedStats
 {
     // Latency tracking
@@ -61,9 +157,14 @@ struct AdvancedStats
         std::atomic<uint64_t> processed{0};
         std::atomic<uint64_t> batches{0};
         std::atomic<double> cpu_utilization{0.0};
+        Log2Histogram batch_sizes; // adaptive batch sizes chosen by this worker
     };
     std::vector<ThreadStats> thread_stats;
 
+    // Pipeline stage latency, merged from workers at exit
+    StageLatency stage_latency;
+    std::mutex merge_mutex;
+
     AdvancedStats(int num_threads = 8) : thread_stats(num_threads) {}
 
     void addLatency(uint64_t ns)
@@ -72,6 +173,20 @@ struct AdvancedStats
         total_latency_ns.fetch_add(ns, std::memory_order_relaxed);
     }
 
+    void mergeStageLatency(const StageLatency &local)
+    {
+        std::scoped_lock lock(merge_mutex);
+        stage_latency.merge(local);
+    }
+
+    void mergeBatchSizes(uint32_t thread, const Log2Histogram &local)
+    {
+        if (thread >= thread_stats.size())
+            return;
+        std::scoped_lock lock(merge_mutex);
+        thread_stats[thread].batch_sizes.merge(local);
+    }
+
     void updateMemory(size_t current)
     {
         current_memory_usage = current;
@@ -91,15 +206,32 @@ struct Stats
     std::atomic<uint64_t> donefill{0}; // fully filled takers
     std::atomic<uint64_t> resting{0};  // handles currently stored
     std::atomic<uint64_t> cancels{0};
+    std::atomic<uint64_t> migrations{0}; // instruments moved between workers
+    std::atomic<uint64_t> mass_quotes{0};  // mass quotes acknowledged
+    std::atomic<uint64_t> quote_sides{0};  // quote sides placed, moved or pulled
+    std::atomic<uint64_t> quote_amends{0}; // quote sides amended in place (priority kept)
+    std::atomic<uint64_t> implied_trades{0}; // matches through implied spread prices
+    std::atomic<uint64_t> dark_trades{0};    // dark midpoint crosses
+    std::atomic<uint64_t> book_hash{0};      // final resting-order hash over all books (0 = not taken)
+    std::atomic<uint64_t> hot_poc_tick{0};   // instrument 0's point of control (most traded tick)
+    std::atomic<uint64_t> hot_poc_volume{0}; // and the volume traded there (0 = not taken)
 
     // timing
     std::chrono::high_resolution_clock::time_point t0, t1;
+    std::chrono::high_resolution_clock::time_point t_launch; // setup began (see launch)
+    bool launched = false;
 
     // Advanced metrics
     std::unique_ptr<AdvancedStats> advanced;
 
     Stats() : advanced(std::make_unique<AdvancedStats>()) {}
 
+    // Mark the start of setup: time to ready runs from here to start()
+    void launch()
+    {
+        t_launch = std::chrono::high_resolution_clock::now();
+        launched = true;
+    }
     void start() { t0 = std::chrono::high_resolution_clock::now(); }
     void stop() { t1 = std::chrono::high_resolution_clock::now(); }
 
@@ -122,6 +254,22 @@ struct Stats
         printf("║  │ Rejected Orders:  %15s │ ║\n", formatNumber(rejected.load()).c_str());
         printf("║  │ Immediate Fills:  %15s │ ║\n", formatNumber(donefill.load()).c_str());
         printf("║  │ Cancelled Orders: %15s │ ║\n", formatNumber(cancels.load()).c_str());
+        printf("║  │ Book Migrations:  %15s │ ║\n", formatNumber(migrations.load()).c_str());
+        if (mass_quotes.load())
+        {
+            printf("║  │ Mass Quotes:      %15s │ ║\n", formatNumber(mass_quotes.load()).c_str());
+            printf("║  │ Quote Sides:      %15s │ ║\n", formatNumber(quote_sides.load()).c_str());
+            printf("║  │ Amended In Place: %15s │ ║\n", formatNumber(quote_amends.load()).c_str());
+        }
+        if (dark_trades.load())
+            printf("║  │ Dark Crosses:     %15s │ ║\n", formatNumber(dark_trades.load()).c_str());
+        if (implied_trades.load())
+            printf("║  │ Implied Trades:   %15s │ ║\n", formatNumber(implied_trades.load()).c_str());
+        if (hot_poc_volume.load())
+            printf("║  │ Hot POC:  %7llu @ %13s │ ║\n", (unsigned long long)hot_poc_tick.load(),
+                   formatNumber(hot_poc_volume.load()).c_str());
+        if (book_hash.load())
+            printf("║  │ Book Hash:       %016llx │ ║\n", (unsigned long long)book_hash.load());
         printf("║  └────────────────────────────────────────────────────────┘ ║\n");
         printf("║                                                              ║\n");
         printf("║  ⚡ PERFORMANCE METRICS                                     ║\n");
@@ -133,6 +281,9 @@ struct Stats
             printf("║  │ Throughput:     %15.2f orders/sec │ ║\n", extra_orders_per_sec);
         }
         printf("║  │ Total Time:     %15.6f seconds    │ ║\n", secs);
+        if (launched)
+            printf("║  │ Time to Ready:  %15.3f ms         │ ║\n",
+                   std::chrono::duration<double, std::milli>(t0 - t_launch).count());
         printf("║  └────────────────────────────────────────────────────────┘ ║\n");
 
         // Advanced stats sections
@@ -141,6 +292,11 @@ struct Stats
             printLatencyStats();
         }
 
+        if (show_latency && advanced->stage_latency.stages[StageLatency::END_TO_END].count > 0)
+        {
+            printStageLatency();
+        }
+
         if (show_memory)
         {
             printMemoryStats();
@@ -186,6 +342,25 @@ private:
         printf("║  └────────────────────────────────────────────────────────┘ ║\n");
     }
 
+    void printStageLatency() const
+    {
+        const StageLatency &sl = advanced->stage_latency;
+        printf("║                                                              ║\n");
+        printf("║  ⏱️  PIPELINE STAGE LATENCY (ns, %s samples)                ║\n",
+               formatNumber(sl.stages[StageLatency::END_TO_END].count).c_str());
+        printf("║  ┌────────────────────────────────────────────────────────┐ ║\n");
+        printf("║  │ %-11s %10s %10s %10s %10s │ ║\n", "Stage", "Mean", "P50", "P99", "Max");
+        for (int i = 0; i < StageLatency::NUM_STAGES; ++i)
+        {
+            const Log2Histogram &h = sl.stages[i];
+            if (i == StageLatency::CANCEL_ACK && h.count == 0)
+                continue;
+            printf("║  │ %-11s %10lu %10lu %10lu %10lu │ ║\n", StageLatency::names[i],
+                   h.mean(), h.percentile(50), h.percentile(99), h.max);
+        }
+        printf("║  └────────────────────────────────────────────────────────┘ ║\n");
+    }
+
     void printMemoryStats() const
     {
         printf("║                                                              ║\n");
@@ -225,6 +400,36 @@ private:
                    i, formatNumber(ts.processed.load()).c_str(),
                    formatNumber(ts.batches.load()).c_str());
         }
+        printf("║  ├────────────────────────────────────────────────────────┤ ║\n");
+        printf("║  │ Adaptive batch size  %8s %8s %8s %8s │ ║\n", "Mean", "P50", "P99", "Max");
+        for (size_t i = 0; i < advanced->thread_stats.size(); ++i)
+        {
+            const Log2Histogram &h = advanced->thread_stats[i].batch_sizes;
+            if (h.count == 0)
+                continue;
+            printf("║  │ Thread %zu:           %8lu %8lu %8lu %8lu │ ║\n",
+                   i, h.mean(), h.percentile(50), h.percentile(99), h.max);
+        }
         printf("║  └────────────────────────────────────────────────────────┘ ║\n");
     }
 };
+
+// Side-by-side throughput of the producer/consumer pipeline and the thread-per-core reactor
+inline void printLayoutComparison(const Stats &pipeline, const Stats &reactor)
+{
+    auto rate = [](const Stats &s)
+    {
+        const double secs = std::chrono::duration<double>(s.t1 - s.t0).count();
+        return secs > 0.0 ? s.popped.load() / secs : 0.0;
+    };
+    const double p = rate(pipeline), r = rate(reactor);
+    printf("\n");
+    printf("╔══════════════════════════════════════════════════════════════╗\n");
+    printf("║  🏁 LAYOUT COMPARISON                                       ║\n");
+    printf("║  ┌────────────────────────────────────────────────────────┐ ║\n");
+    printf("║  │ Pipeline (1 producer + N workers): %15.2f orders/sec │ ║\n", p);
+    printf("║  │ Reactor (thread-per-core):         %15.2f orders/sec │ ║\n", r);
+    printf("║  │ Speedup:                           %15.2fx           │ ║\n", p > 0.0 ? r / p : 0.0);
+    printf("║  └────────────────────────────────────────────────────────┘ ║\n");
+    printf("╚══════════════════════════════════════════════════════════════╝\n");
+}
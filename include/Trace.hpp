@@ -0,0 +1,151 @@
+#pragma once
+// Lightweight per-thread event tracer with Chrome trace (Perfetto) export.
+//
+// Build with -DORDERBOOK_TRACE=ON to enable. When disabled every TRACE_* macro
+// expands to nothing, so the hot paths compile exactly as before.
+#include <cstdint>
+
+enum class TraceEvent : uint16_t
+{
+    BatchPop = 0,   // worker popping a batch from its ring
+    Match,          // worker processing a popped batch
+    StatsFlush,     // worker publishing local counters to Stats
+    Backoff,        // worker spinning on an empty ring
+    ProducerBackoff // generator spinning on a full ring
+};
+
+#ifdef ORDERBOOK_TRACE
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Tsc.hpp"
+
+class Tracer
+{
+public:
+    enum Phase : uint8_t { BEGIN = 0, END = 1, INSTANT = 2 };
+
+    struct Record
+    {
+        uint64_t tsc;
+        uint32_t arg;
+        uint16_t event;
+        uint8_t phase;
+        uint8_t _pad{0};
+    };
+
+    // Per-thread buffer. Only the owning thread writes; export reads after join.
+    struct Buffer
+    {
+        static constexpr size_t CAPACITY = 1 << 18; // 4 MB of records per thread
+        std::unique_ptr<Record[]> recs{new Record[CAPACITY]};
+        size_t count{0};
+        uint64_t dropped{0};
+        std::string name;
+    };
+
+    static Tracer &instance()
+    {
+        static Tracer t;
+        return t;
+    }
+
+    static inline void record(TraceEvent ev, Phase ph, uint64_t tsc, uint32_t arg)
+    {
+        Buffer *b = tls_buffer_;
+        if (__builtin_expect(b == nullptr, 0))
+            b = instance().attach();
+        if (__builtin_expect(b->count < Buffer::CAPACITY, 1))
+            b->recs[b->count++] = Record{tsc, arg, (uint16_t)ev, ph};
+        else
+            ++b->dropped;
+    }
+
+    static void set_thread_name(const std::string &name)
+    {
+        Buffer *b = tls_buffer_ ? tls_buffer_ : instance().attach();
+        b->name = name;
+    }
+
+    // Write all buffers as Chrome trace JSON. Call after all traced threads have joined.
+    bool write_chrome_json(const char *path)
+    {
+        std::scoped_lock lock(mu_);
+        FILE *f = std::fopen(path, "w");
+        if (!f)
+            return false;
+
+        uint64_t base = ~0ull;
+        uint64_t dropped = 0;
+        for (auto &b : buffers_)
+            if (b->count && b->recs[0].tsc < base)
+                base = b->recs[0].tsc;
+        const double us_per_tick = TscClock::ns_per_tick() / 1000.0;
+
+        static const char *names[] = {"batch_pop", "match", "stats_flush", "backoff", "producer_backoff"};
+        static const char phases[] = {'B', 'E', 'i'};
+
+        std::fprintf(f, "{\"traceEvents\":[\n");
+        bool first = true;
+        for (size_t tid = 0; tid < buffers_.size(); ++tid)
+        {
+            const Buffer &b = *buffers_[tid];
+            dropped += b.dropped;
+            std::fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,\"args\":{\"name\":\"%s\"}}",
+                         first ? "" : ",\n", tid, b.name.empty() ? "thread" : b.name.c_str());
+            first = false;
+            for (size_t i = 0; i < b.count; ++i)
+            {
+                const Record &r = b.recs[i];
+                std::fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%zu%s,\"args\":{\"arg\":%u}}",
+                             names[r.event], phases[r.phase], (double)(r.tsc - base) * us_per_tick, tid,
+                             r.phase == INSTANT ? ",\"s\":\"t\"" : "", r.arg);
+            }
+        }
+        std::fprintf(f, "\n]}\n");
+        std::fclose(f);
+
+        printf("Trace written to %s (%zu threads, %llu events dropped)\n",
+               path, buffers_.size(), (unsigned long long)dropped);
+        return true;
+    }
+
+private:
+    Buffer *attach()
+    {
+        std::scoped_lock lock(mu_);
+        buffers_.push_back(std::make_unique<Buffer>());
+        tls_buffer_ = buffers_.back().get();
+        return tls_buffer_;
+    }
+
+    std::mutex mu_;
+    std::vector<std::unique_ptr<Buffer>> buffers_;
+    static inline thread_local Buffer *tls_buffer_ = nullptr;
+};
+
+#define TRACE_TSC() rdtsc()
+#define TRACE_BEGIN(ev, arg) Tracer::record((ev), Tracer::BEGIN, rdtsc(), (uint32_t)(arg))
+#define TRACE_END(ev, arg) Tracer::record((ev), Tracer::END, rdtsc(), (uint32_t)(arg))
+#define TRACE_INSTANT(ev, arg) Tracer::record((ev), Tracer::INSTANT, rdtsc(), (uint32_t)(arg))
+// Emit a span that started at 't0' (from TRACE_TSC) and ends now
+#define TRACE_SPAN(ev, t0, arg)                                          \
+    do                                                                   \
+    {                                                                    \
+        Tracer::record((ev), Tracer::BEGIN, (t0), (uint32_t)(arg));      \
+        Tracer::record((ev), Tracer::END, rdtsc(), (uint32_t)(arg));     \
+    } while (0)
+#define TRACE_THREAD_NAME(name) Tracer::set_thread_name(name)
+
+#else
+
+#define TRACE_TSC() 0ull
+#define TRACE_BEGIN(ev, arg) ((void)0)
+#define TRACE_END(ev, arg) ((void)0)
+#define TRACE_INSTANT(ev, arg) ((void)0)
+#define TRACE_SPAN(ev, t0, arg) ((void)0)
+#define TRACE_THREAD_NAME(name) ((void)0)
+
+#endif
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+#include <chrono>
+#include <x86intrin.h> // __rdtsc
+
+// Raw timestamp counter read. Cheap (~20 cycles) and not serializing, which is fine
+// for tracing and sampled latency where a few cycles of skew do not matter.
+static inline uint64_t rdtsc() { return __rdtsc(); }
+
+// TSC -> nanoseconds conversion, calibrated once against steady_clock.
+struct TscClock
+{
+    static double ns_per_tick()
+    {
+        static const double ratio = calibrate();
+        return ratio;
+    }
+
+    static uint64_t to_ns(uint64_t ticks) { return (uint64_t)(ticks * ns_per_tick()); }
+
+private:
+    static double calibrate()
+    {
+        using clock = std::chrono::steady_clock;
+        const auto c0 = clock::now();
+        const uint64_t t0 = rdtsc();
+        while (clock::now() - c0 < std::chrono::milliseconds(10))
+        {
+        }
+        const auto c1 = clock::now();
+        const uint64_t t1 = rdtsc();
+        const double ns = std::chrono::duration<double, std::nano>(c1 - c0).count();
+        return (t1 > t0) ? ns / (double)(t1 - t0) : 1.0;
+    }
+};
@@ -0,0 +1,123 @@
+// VolumeProfile.hpp
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <cstring> // memset
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// Session volume-at-price for one book: traded quantity and trade count per tick. The crossing
+// loops record each fill with two adds at the fill's tick; queries reduce a tick range with
+// SIMD (AVX2 when the build enables it, SSE2 otherwise, scalar tails).
+template <uint32_t TICKS>
+class VolumeProfile {
+public:
+    struct Summary {
+        uint64_t volume{0};
+        uint64_t trades{0};
+        uint32_t poc{~0u};       // point of control: lowest tick with the most volume (~0u if none)
+        uint64_t poc_volume{0};
+    };
+
+    void reset() {
+        std::memset(volume_.data(), 0, sizeof(volume_));
+        std::memset(trades_.data(), 0, sizeof(trades_));
+    }
+
+    inline void add(uint32_t tick, uint64_t qty, uint32_t trades = 1) {
+        volume_[tick] += qty;
+        trades_[tick] += trades;
+    }
+
+    inline uint64_t volume_at(uint32_t tick) const { return volume_[tick]; }
+    inline uint32_t trades_at(uint32_t tick) const { return trades_[tick]; }
+
+    // Traded volume over ticks [lo, hi)
+    uint64_t volume(uint32_t lo, uint32_t hi) const {
+        hi = clamp(hi);
+        uint64_t sum = 0;
+        uint32_t t = lo;
+#if defined(__AVX2__)
+        __m256i acc = _mm256_setzero_si256();
+        for (; t + 4 <= hi; t += 4) acc = _mm256_add_epi64(acc, _mm256_loadu_si256((const __m256i*)&volume_[t]));
+        sum = hsum(acc);
+#elif defined(__SSE2__)
+        __m128i acc = _mm_setzero_si128();
+        for (; t + 2 <= hi; t += 2) acc = _mm_add_epi64(acc, _mm_loadu_si128((const __m128i*)&volume_[t]));
+        sum = hsum(acc);
+#endif
+        for (; t < hi; ++t) sum += volume_[t];
+        return sum;
+    }
+
+    // Trade count over ticks [lo, hi)
+    uint64_t trades(uint32_t lo, uint32_t hi) const {
+        hi = clamp(hi);
+        uint64_t sum = 0;
+        uint32_t t = lo;
+#if defined(__AVX2__)
+        __m256i acc = _mm256_setzero_si256();
+        for (; t + 4 <= hi; t += 4)
+            acc = _mm256_add_epi64(acc, _mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i*)&trades_[t])));
+        sum = hsum(acc);
+#elif defined(__SSE2__)
+        const __m128i zero = _mm_setzero_si128();
+        __m128i acc = zero;
+        for (; t + 4 <= hi; t += 4) {
+            const __m128i v = _mm_loadu_si128((const __m128i*)&trades_[t]);
+            acc = _mm_add_epi64(acc, _mm_add_epi64(_mm_unpacklo_epi32(v, zero), _mm_unpackhi_epi32(v, zero)));
+        }
+        sum = hsum(acc);
+#endif
+        for (; t < hi; ++t) sum += trades_[t];
+        return sum;
+    }
+
+    // Most traded tick in [lo, hi) and its volume: a vector max pass, then the first tick at the max
+    Summary summary(uint32_t lo, uint32_t hi) const {
+        hi = clamp(hi);
+        Summary s;
+        s.volume = volume(lo, hi);
+        s.trades = trades(lo, hi);
+        if (s.volume == 0) return s;
+
+        uint64_t best = 0;
+        uint32_t t = lo;
+#if defined(__AVX2__)
+        // volumes stay far below 2^63, so the signed 64-bit compare is exact
+        __m256i mx = _mm256_setzero_si256();
+        for (; t + 4 <= hi; t += 4) {
+            const __m256i v = _mm256_loadu_si256((const __m256i*)&volume_[t]);
+            mx = _mm256_blendv_epi8(mx, v, _mm256_cmpgt_epi64(v, mx));
+        }
+        alignas(32) uint64_t lanes[4];
+        _mm256_store_si256((__m256i*)lanes, mx);
+        for (uint64_t l : lanes) best = l > best ? l : best;
+#endif
+        for (; t < hi; ++t) best = volume_[t] > best ? volume_[t] : best;
+
+        for (t = lo; volume_[t] != best; ++t) {}
+        s.poc = t;
+        s.poc_volume = best;
+        return s;
+    }
+
+private:
+    alignas(64) std::array<uint64_t, TICKS> volume_{};
+    alignas(64) std::array<uint32_t, TICKS> trades_{};
+
+    static inline uint32_t clamp(uint32_t hi) { return hi < TICKS ? hi : TICKS; }
+
+#if defined(__AVX2__)
+    static inline uint64_t hsum(__m256i v) {
+        const __m128i s = _mm_add_epi64(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+        return (uint64_t)_mm_cvtsi128_si64(s) + (uint64_t)_mm_cvtsi128_si64(_mm_unpackhi_epi64(s, s));
+    }
+#elif defined(__SSE2__)
+    static inline uint64_t hsum(__m128i v) {
+        return (uint64_t)_mm_cvtsi128_si64(v) + (uint64_t)_mm_cvtsi128_si64(_mm_unpackhi_epi64(v, v));
+    }
+#endif
+};
@@ -2,13 +2,159 @@
 #include <thread>
 #include <vector>
 #include <atomic>
+#include <chrono>
 #include <cstdlib>
 #include "Config.hpp"
-#include "AtomicRingBuffer.hpp"
+#include "EngineCounters.hpp"
+#include "MpscLanes.hpp"
 #include "OrderManager.hpp"
 #include "OrderGenerator.hpp"
 #include "MatchingWorker.hpp"
+#include "InstrumentBook.hpp"
+#include "Rebalancer.hpp"
+#include "Reactor.hpp"
 #include "Stats.hpp"
+#include "Trace.hpp"
+
+// Producer/consumer layout: gateway (generator) threads route into per-worker rings
+static void runPipeline(const Config &config, Stats &stats, OrderManager &orderManager, int NUM_WORKERS)
+{
+    stats.launch();
+
+    // Create per-worker queues, one SPSC ring (lane) per gateway each, so neither gateways nor
+    // workers contend. Their cells are written by the owning workers when they start, all
+    // queues in parallel.
+    std::cout << "Creating per-worker ring buffers..." << std::endl;
+    const uint32_t gateways = config.gateways ? config.gateways : 1;
+    const size_t lane_capacity = config.RING_CAPACITY / NUM_WORKERS / gateways;
+    std::vector<MpscLanes<OrderMsg> *> rings;
+    rings.reserve(NUM_WORKERS);
+    for (int i = 0; i < NUM_WORKERS; ++i)
+        rings.push_back(new MpscLanes<OrderMsg>(lane_capacity, gateways, config.sequenced_ingress, true));
+    std::cout << "Created " << NUM_WORKERS << " ring buffers (" << gateways << " lane(s) each, lane capacity: "
+              << lane_capacity << (config.sequenced_ingress ? ", sequenced" : "") << ")" << std::endl;
+
+    // Optional priority lanes for cancels, drained by each worker ahead of its ring
+    std::vector<MpscLanes<OrderMsg> *> cancel_rings;
+    if (config.cancel_lane)
+    {
+        for (int i = 0; i < NUM_WORKERS; ++i)
+            cancel_rings.push_back(new MpscLanes<OrderMsg>(Config::CANCEL_LANE_CAPACITY, gateways, false, true));
+        std::cout << "Created " << NUM_WORKERS << " priority cancel lanes" << std::endl;
+    }
+
+    // Create done flag
+    std::atomic<bool> done(false);
+    std::cout << "Done flag created" << std::endl;
+
+    // Create instrument books (symbol-affine: instrument i starts on worker i % NUM_WORKERS)
+    std::cout << "Creating instrument books..." << std::endl;
+    InstrumentDirectory directory(config.num_instruments, NUM_WORKERS);
+    directory.enableQueuePosition(config.queue_position_instruments);
+    std::cout << config.num_instruments << " instrument books created" << std::endl;
+    if (config.preload_orders)
+    {
+        const auto t0 = std::chrono::steady_clock::now();
+        const uint64_t loaded = directory.preload(config.preload_orders, config.span_ticks, config.max_qty);
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        std::cout << loaded << " resting orders preloaded in " << ms << " ms" << std::endl;
+    }
+    if (config.spreads)
+        std::cout << directory.linkSpreads(config.spreads) << " calendar spreads linked for implied matching" << std::endl;
+
+    // Create multiple MatchingWorkers for better throughput
+    std::cout << "Creating MatchingWorkers..." << std::endl;
+    std::vector<MatchingWorker> workers;
+    workers.reserve(NUM_WORKERS);
+
+    for (int i = 0; i < NUM_WORKERS; i++)
+    {
+        workers.emplace_back(i, *rings[i], config.cancel_lane ? cancel_rings[i] : nullptr, orderManager, stats, config,
+                             done, directory);
+    }
+    std::cout << NUM_WORKERS << " MatchingWorkers created" << std::endl;
+
+    // Create the gateways (OrderGenerators), each routing its instruments into its lane of every worker's queue
+    std::cout << "Creating OrderGenerator..." << std::endl;
+    std::atomic<uint32_t> running(gateways);
+    std::vector<OrderGenerator> generators;
+    generators.reserve(gateways);
+    for (uint32_t g = 0; g < gateways; ++g)
+        generators.emplace_back(rings, cancel_rings, g, gateways, running, orderManager, config, done, stats, directory);
+    std::cout << gateways << " OrderGenerator(s) created" << std::endl;
+
+    std::cout << "All modules created successfully. Starting threads..." << std::endl;
+
+    // Start consumer threads (multiple workers)
+    std::vector<std::thread> consumer_threads;
+    for (int i = 0; i < NUM_WORKERS; i++)
+    {
+        consumer_threads.emplace_back(std::ref(workers[i]));
+        std::cout << "Consumer thread " << (i + 1) << " started" << std::endl;
+    }
+
+    // Ready once every worker has built its ring; the timed run starts here
+    for (auto *r : rings)
+        while (!r->ready())
+            std::this_thread::yield();
+    for (auto *r : cancel_rings)
+        while (!r->ready())
+            std::this_thread::yield();
+    stats.start();
+
+    // Start producer threads (one per gateway)
+    std::vector<std::thread> producer_threads;
+    for (auto &g : generators)
+        producer_threads.emplace_back(std::ref(g));
+    std::cout << "Producer thread" << (gateways > 1 ? "s" : "") << " started" << std::endl;
+
+    // Start rebalance controller
+    RebalanceController rebalancer(directory, config, done, stats);
+    std::thread rebalance_thread;
+    if (config.rebalance)
+    {
+        rebalance_thread = std::thread(std::ref(rebalancer));
+        std::cout << "Rebalance controller started" << std::endl;
+    }
+
+    std::cout << "Waiting for threads to complete..." << std::endl;
+
+    // Wait for producers to finish
+    for (auto &thread : producer_threads)
+        thread.join();
+    std::cout << "Producer thread" << (gateways > 1 ? "s" : "") << " joined" << std::endl;
+
+    // Wait for all consumers to finish
+    for (auto &thread : consumer_threads)
+    {
+        thread.join();
+    }
+    std::cout << "All consumer threads joined" << std::endl;
+
+    if (rebalance_thread.joinable())
+        rebalance_thread.join();
+
+    std::cout << "Threads completed." << std::endl;
+
+    // Stop timing
+    stats.stop();
+
+    uint64_t implied_trades, implied_volume;
+    directory.impliedTotals(implied_trades, implied_volume);
+    stats.implied_trades.store(implied_trades);
+    stats.dark_trades.store(directory.darkTrades());
+    stats.book_hash.store(directory.bookHash());
+    const auto poc = directory.volumeSummary(0);
+    stats.hot_poc_tick.store(poc.poc);
+    stats.hot_poc_volume.store(poc.poc_volume);
+
+    // free ring buffers
+    for (auto r : rings)
+        delete r;
+    for (auto r : cancel_rings)
+        delete r;
+
+}
 
 int main(int argc, char *argv[])
 {
@@ -46,6 +192,130 @@ int main(int argc, char *argv[])
             config.show_all_advanced = true;
             std::cout << "✅ All advanced stats enabled" << std::endl;
         }
+        else if (arg == "--reactor")
+        {
+            config.reactor = true;
+            std::cout << "✅ Thread-per-core reactor layout" << std::endl;
+        }
+        else if (arg == "--compare")
+        {
+            config.compare_layouts = true;
+            std::cout << "✅ Benchmarking pipeline vs reactor layouts" << std::endl;
+        }
+        else if (arg == "--shared-pool")
+        {
+            config.shared_pool = true;
+            std::cout << "✅ Reactor books share one order pool per shard" << std::endl;
+        }
+        else if (arg == "--pegs" && i + 1 < argc)
+        {
+            config.peg_pct = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+            std::cout << "✅ Pegged orders: " << config.peg_pct << "% of adds" << std::endl;
+        }
+        else if (arg == "--hidden" && i + 1 < argc)
+        {
+            config.hidden_pct = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+            std::cout << "✅ Hidden orders: " << config.hidden_pct << "% of adds" << std::endl;
+        }
+        else if (arg == "--post-only" && i + 1 < argc)
+        {
+            config.post_only_pct = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+            std::cout << "✅ Post-only orders: " << config.post_only_pct << "% of adds" << std::endl;
+        }
+        else if (arg == "--mass-quotes" && i + 1 < argc)
+        {
+            config.mass_quote_every = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+            std::cout << "✅ Mass quote every " << config.mass_quote_every << " messages" << std::endl;
+        }
+        else if (arg == "--quote-size" && i + 1 < argc)
+        {
+            config.mass_quote_size = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+            std::cout << "✅ Mass quote size: " << config.mass_quote_size << " instruments" << std::endl;
+        }
+        else if (arg == "--spreads" && i + 1 < argc)
+        {
+            config.spreads = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+            std::cout << "✅ Calendar spreads with implied matching: " << config.spreads << std::endl;
+        }
+        else if (arg == "--dark" && i + 1 < argc)
+        {
+            config.dark_pct = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+            std::cout << "✅ Dark midpoint orders: " << config.dark_pct << "% of adds" << std::endl;
+        }
+        else if (arg == "--min-fill" && i + 1 < argc)
+        {
+            config.min_fill_pct = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+            std::cout << "✅ All-or-none / minimum-quantity orders: " << config.min_fill_pct << "% of adds" << std::endl;
+        }
+        else if (arg == "--gateways" && i + 1 < argc)
+        {
+            config.gateways = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+            std::cout << "✅ Gateways: " << config.gateways << " generator threads, one lane each per worker" << std::endl;
+        }
+        else if (arg == "--sequenced")
+        {
+            config.sequenced_ingress = true;
+            std::cout << "✅ Sequenced ingress: workers take messages in global arrival order" << std::endl;
+        }
+        else if (arg == "--cancel-lane")
+        {
+            config.cancel_lane = true;
+            std::cout << "✅ Priority cancel lane: cancels are drained ahead of new orders" << std::endl;
+        }
+        else if (arg == "--preload" && i + 1 < argc)
+        {
+            config.preload_orders = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+            std::cout << "✅ Preloaded book depth: " << config.preload_orders << " orders per instrument" << std::endl;
+        }
+        else if (arg == "--queue-position" && i + 1 < argc)
+        {
+            config.queue_position_instruments = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+            std::cout << "✅ Queue-position index on first " << config.queue_position_instruments << " instruments" << std::endl;
+        }
+        else if (arg == "--compact-ns" && i + 1 < argc)
+        {
+            config.compact_budget_ns = std::strtoull(argv[++i], nullptr, 10);
+            std::cout << "✅ Pool compaction budget: " << config.compact_budget_ns << " ns per batch" << std::endl;
+        }
+        else if (arg == "--cold-after" && i + 1 < argc)
+        {
+            config.cold_book_idle_ops = std::strtoull(argv[++i], nullptr, 10);
+            std::cout << "✅ Idle books compacted after " << config.cold_book_idle_ops << " ops" << std::endl;
+        }
+        else if (arg == "--instruments" && i + 1 < argc)
+        {
+            config.num_instruments = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+            std::cout << "✅ Instruments: " << config.num_instruments << std::endl;
+        }
+        else if (arg == "--orders" && i + 1 < argc)
+        {
+            config.num_orders = std::strtoull(argv[++i], nullptr, 10);
+            std::cout << "✅ Orders: " << config.num_orders << std::endl;
+        }
+        else if (arg == "--no-rebalance")
+        {
+            config.rebalance = false;
+            std::cout << "✅ Instrument rebalancing disabled" << std::endl;
+        }
+        else if (arg == "--batch-target" && i + 1 < argc)
+        {
+            config.batch_latency_target_ns = std::strtoull(argv[++i], nullptr, 10);
+            std::cout << "✅ Batch latency target: " << config.batch_latency_target_ns << " ns" << std::endl;
+        }
+        else if (arg == "--sample" && i + 1 < argc)
+        {
+            config.latency_sample_every = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+            std::cout << "✅ Stage latency sampling: 1 in " << config.latency_sample_every << std::endl;
+        }
+        else if (arg == "--trace" && i + 1 < argc)
+        {
+            config.trace_path = argv[++i];
+#ifdef ORDERBOOK_TRACE
+            std::cout << "✅ Event trace will be written to " << config.trace_path << std::endl;
+#else
+            std::cout << "⚠️  Tracing not compiled in (configure with -DORDERBOOK_TRACE=ON)" << std::endl;
+#endif
+        }
         else if (arg == "--help" || arg == "-h")
         {
             std::cout << "HFT Orderbook Engine - Advanced Stats Demo\n";
@@ -56,6 +326,30 @@ int main(int argc, char *argv[])
             std::cout << "  -c, --cache      Show cache performance stats\n";
             std::cout << "  -t, --threads    Show per-thread performance\n";
             std::cout << "  -a, --all        Show all advanced stats\n";
+            std::cout << "  --reactor        Thread-per-core layout (each shard generates and matches locally)\n";
+            std::cout << "  --compare        Run pipeline then reactor on the same flow and compare\n";
+            std::cout << "  --shared-pool    Reactor shards host instruments in one shared-pool EngineGroup\n";
+            std::cout << "  --instruments <N> Number of instruments\n";
+            std::cout << "  --pegs <PCT>     Send PCT% of adds as midpoint/primary pegs\n";
+            std::cout << "  --hidden <PCT>   Send PCT% of adds fully hidden\n";
+            std::cout << "  --post-only <PCT> Send PCT% of adds post-only (reject or slide)\n";
+            std::cout << "  --dark <PCT>     Send PCT% of adds to the dark midpoint book\n";
+            std::cout << "  --min-fill <PCT> Send PCT% of adds all-or-none or with a minimum quantity\n";
+            std::cout << "  --mass-quotes <N> Every Nth message is a market maker's mass quote\n";
+            std::cout << "  --quote-size <N> Instruments per mass quote\n";
+            std::cout << "  --spreads <N>    Link N calendar spreads to their legs (implied matching)\n";
+            std::cout << "  --queue-position <N> Queue-position index on instruments [0, N)\n";
+            std::cout << "  --preload <N>    Bulk-load N resting orders into each book before the flow\n";
+            std::cout << "  --gateways <N>   Pipeline generator threads, each with its own lane per worker\n";
+            std::cout << "  --sequenced      Workers take messages in global arrival order across gateways\n";
+            std::cout << "  --cancel-lane    Send cancels through a per-worker priority lane\n";
+            std::cout << "  --compact-ns <NS> Per-batch pool compaction budget (0 = off)\n";
+            std::cout << "  --cold-after <N> Compact shared-pool books idle for N ops\n";
+            std::cout << "  --orders <N>     Number of messages to generate\n";
+            std::cout << "  --no-rebalance   Keep instruments on their initial workers\n";
+            std::cout << "  --batch-target <ns> Latency budget for adaptive worker batches\n";
+            std::cout << "  --sample <N>     Stamp 1 in N messages for stage latency (0 = off)\n";
+            std::cout << "  --trace <file>   Chrome trace output path (needs -DORDERBOOK_TRACE=ON)\n";
             std::cout << "  -h, --help       Show this help\n";
             return 0;
         }
@@ -63,21 +357,7 @@ int main(int argc, char *argv[])
 
     std::cout << "Config created successfully" << std::endl;
 
-    // Create per-worker ring buffers (SPSC each) to avoid consumer contention
-    std::cout << "Creating per-worker ring buffers..." << std::endl;
     const int NUM_WORKERS = 8; // Use 8 worker threads for maximum throughput
-    std::vector<AtomicRingBuffer<OrderMsg> *> rings;
-    rings.reserve(NUM_WORKERS);
-    for (int i = 0; i < NUM_WORKERS; ++i)
-    {
-        AtomicRingBuffer<OrderMsg> *r = new AtomicRingBuffer<OrderMsg>(config.RING_CAPACITY / NUM_WORKERS);
-        rings.push_back(r);
-    }
-    std::cout << "Created " << NUM_WORKERS << " ring buffers (each capacity: " << (config.RING_CAPACITY / NUM_WORKERS) << ")" << std::endl;
-
-    // Create done flag
-    std::atomic<bool> done(false);
-    std::cout << "Done flag created" << std::endl;
 
     // Create OrderManager (sharded)
     std::cout << "Creating sharded OrderManager..." << std::endl;
@@ -89,56 +369,24 @@ int main(int argc, char *argv[])
     Stats stats;
     std::cout << "Stats created" << std::endl;
 
-    // Create multiple MatchingWorkers for better throughput
-    std::cout << "Creating MatchingWorkers..." << std::endl;
-    std::vector<MatchingWorker> workers;
-    workers.reserve(NUM_WORKERS);
-
-    for (int i = 0; i < NUM_WORKERS; i++)
+    if (config.compare_layouts)
     {
-        workers.emplace_back(*rings[i], orderManager, stats, done);
+        // Same flow through both layouts; the full report below is for the reactor run
+        Stats pipeline_stats;
+        std::cout << "=== Producer/consumer pipeline ===" << std::endl;
+        runPipeline(config, pipeline_stats, orderManager, NUM_WORKERS);
+        std::cout << "=== Thread-per-core reactor ===" << std::endl;
+        runReactor(config, stats, NUM_WORKERS);
+        printLayoutComparison(pipeline_stats, stats);
     }
-    std::cout << NUM_WORKERS << " MatchingWorkers created" << std::endl;
-
-    // Create OrderGenerator (routes to per-worker rings)
-    std::cout << "Creating OrderGenerator..." << std::endl;
-    OrderGenerator generator(rings, orderManager, config, done, stats);
-    std::cout << "OrderGenerator created" << std::endl;
-
-    std::cout << "All modules created successfully. Starting threads..." << std::endl;
-
-    // Start timing
-    stats.start();
-
-    // Start consumer threads (multiple workers)
-    std::vector<std::thread> consumer_threads;
-    for (int i = 0; i < NUM_WORKERS; i++)
+    else if (config.reactor)
     {
-        consumer_threads.emplace_back(std::ref(workers[i]));
-        std::cout << "Consumer thread " << (i + 1) << " started" << std::endl;
+        runReactor(config, stats, NUM_WORKERS);
     }
-
-    // Start producer thread
-    std::thread producer_thread(std::ref(generator));
-    std::cout << "Producer thread started" << std::endl;
-
-    std::cout << "Waiting for threads to complete..." << std::endl;
-
-    // Wait for producer to finish
-    producer_thread.join();
-    std::cout << "Producer thread joined" << std::endl;
-
-    // Wait for all consumers to finish
-    for (auto &thread : consumer_threads)
+    else
     {
-        thread.join();
+        runPipeline(config, stats, orderManager, NUM_WORKERS);
     }
-    std::cout << "All consumer threads joined" << std::endl;
-
-    std::cout << "Threads completed." << std::endl;
-
-    // Stop timing
-    stats.stop();
 
     std::cout << "Getting final stats..." << std::endl;
 
@@ -182,9 +430,12 @@ int main(int argc, char *argv[])
 
     stats.print(final_stats.throughput, show_latency, show_memory, show_cache, show_threads);
 
-    // free ring buffers
-    for (auto r : rings)
-        delete r;
+#ifdef ORDERBOOK_TRACE
+    Tracer::instance().write_chrome_json(config.trace_path);
+#endif
+#ifdef ORDERBOOK_ENGINE_COUNTERS
+    EngineCounters::instance().report();
+#endif
 
     std::cout << "Program completed successfully!" << std::endl;
     return 0;
@@ -1,38 +1,216 @@
 #include "MatchingWorker.hpp"
+#include "EngineCounters.hpp"
 #include "OrderMsg.hpp"
+#include "Trace.hpp"
+#include "Tsc.hpp"
 #include <immintrin.h>   // _mm_pause
 #include <thread>        // std::this_thread::yield
-#include <unordered_map> // for tracking synthetic to engine handle mapping
 
-MatchingWorker::MatchingWorker(AtomicRingBuffer<OrderMsg> &ring,
+MatchingWorker::MatchingWorker(uint32_t id,
+                               MpscLanes<OrderMsg> &ring,
+                               MpscLanes<OrderMsg> *cancels,
                                OrderManager &orderManager,
                                Stats &stats,
-                               std::atomic<bool> &done_flag)
-    : ring_(ring), orderManager_(orderManager), stats_(stats), done_(done_flag) {}
+                               const Config &cfg,
+                               std::atomic<bool> &done_flag,
+                               InstrumentDirectory &dir)
+    : id_(id), ring_(ring), cancels_(cancels), orderManager_(orderManager), stats_(stats), done_(done_flag), dir_(dir),
+      books_(dir.numInstruments(), nullptr),
+      min_batch_(cfg.min_batch ? cfg.min_batch : 1),
+      max_batch_(cfg.max_batch > cfg.min_batch ? cfg.max_batch : (cfg.min_batch ? cfg.min_batch : 1)),
+      batch_latency_target_ns_(cfg.batch_latency_target_ns),
+      compact_budget_ticks_((uint64_t)(cfg.compact_budget_ns / TscClock::ns_per_tick()))
+{
+    // take the instruments placed here initially
+    for (uint32_t i = 0; i < dir_.numInstruments(); ++i)
+    {
+        if (InstrumentDirectory::homeWorker(i, dir_.numWorkers()) != id_)
+            continue;
+        books_[i] = &dir_.book(i);
+        books_[i]->owner_worker.store((int32_t)id_, std::memory_order_relaxed);
+    }
+}
 
-void MatchingWorker::operator()()
+inline void MatchingWorker::process(const OrderMsg &msg)
 {
-    std::vector<OrderMsg> batch(BATCH_SIZE); // Pre-allocate and size buffer for popBatch
+    if (unlikely(msg.msg_type == MessageType::MASS_QUOTE))
+    {
+        applyMassQuote(msg);
+        return;
+    }
+
+    InstrumentBook *book = books_[msg.instrument];
+
+    if (unlikely(book == nullptr))
+    {
+        // Instrument is migrating in; hold until the old owner has drained it
+        parked_[msg.instrument].push_back(msg);
+        return;
+    }
+
+    if (unlikely(msg.msg_type == MessageType::MIGRATE_OUT))
+    {
+        // Every earlier message for this instrument has been applied: hand the book over. Its
+        // cancels sent before the move may still wait in the priority lane, so take them first.
+        if (cancels_)
+            drainCancels();
+        books_[msg.instrument] = nullptr;
+        dir_.publish(msg.instrument, msg.worker_id);
+        return;
+    }
+    if (likely(cancels_ == nullptr))
+    {
+        apply(*book, msg);
+        return;
+    }
+
+    // With a priority lane a cancel can overtake the add it targets. An instrument's client ids
+    // rise with each add, so a cancel for an id above the last add is held until that add.
+    if (msg.msg_type == MessageType::CANCEL_ORDER && msg.handle_to_cancel > book->last_add)
+    {
+        book->held_cancels.push_back(msg);
+        return;
+    }
+    apply(*book, msg);
+    if (msg.msg_type == MessageType::ADD_ORDER)
+    {
+        book->last_add = msg.client_id;
+        if (unlikely(!book->held_cancels.empty()))
+        {
+            auto &held = book->held_cancels;
+            size_t keep = 0;
+            for (size_t i = 0; i < held.size(); ++i)
+            {
+                if (held[i].handle_to_cancel <= book->last_add)
+                    apply(*book, held[i]);
+                else
+                    held[keep++] = held[i];
+            }
+            held.resize(keep);
+        }
+    }
+}
 
-    uint64_t local_popped = 0;
-    uint64_t local_donefill = 0;
-    uint64_t local_cancels = 0;
-    uint64_t local_rejected = 0;
+inline void MatchingWorker::apply(InstrumentBook &book, const OrderMsg &msg)
+{
+    book.apply(msg, local_);
+    noteLowPool(book);
+    if (msg.msg_type == MessageType::CANCEL_ORDER && msg.t_gen)
+    {
+        const uint64_t now = rdtsc();
+        cancel_ack_.record(now > msg.t_gen ? (uint64_t)((now - msg.t_gen) * TscClock::ns_per_tick()) : 0);
+    }
+}
 
-    // Track active orders for this worker - map synthetic handle to engine handle
-    std::unordered_map<uint32_t, uint32_t> synthetic_to_engine_handle;
+// Take everything waiting in the priority lane (at each batch boundary, and before a book
+// is handed over)
+void MatchingWorker::drainCancels()
+{
+    MpscLanes<OrderMsg>::Ticket ticket;
+    while (const OrderMsg *msg = cancels_->peek(ticket))
+    {
+        process(*msg);
+        cancels_->release(ticket);
+    }
+}
+
+// Apply the entries of a mass quote routed here (or, for a parked copy, the one instrument it
+// was held for). Entries for an instrument still migrating in are parked like any message.
+void MatchingWorker::applyMassQuote(const OrderMsg &msg)
+{
+    MassQuote *q = msg.quote;
+    const bool replay = msg.instrument != ALL_INSTRUMENTS;
+    if (!replay)
+        local_.popped++;
+    for (const QuoteEntry &e : q->entries)
+    {
+        if (e.worker != id_ || (replay && e.instrument != msg.instrument))
+            continue;
+        InstrumentBook *book = books_[e.instrument];
+        if (unlikely(book == nullptr))
+        {
+            OrderMsg held = msg;
+            held.instrument = e.instrument;
+            q->retain();
+            parked_[e.instrument].push_back(held);
+            continue;
+        }
+        book->quote(q->maker, e, local_);
+        noteLowPool(*book);
+    }
+    if (q->release())
+    {
+        local_.quote_acks++; // every entry applied: the quote is acknowledged
+        delete q;
+    }
+}
+
+void MatchingWorker::adoptHandoffs()
+{
+    dir_.adopt(id_, [this](InstrumentBook &book)
+               {
+        books_[book.id] = &book;
+        auto it = parked_.find(book.id);
+        if (it == parked_.end())
+            return;
+        // replay held messages before anything newer for this instrument
+        std::vector<OrderMsg> held = std::move(it->second);
+        parked_.erase(it);
+        for (const OrderMsg &m : held)
+            process(m); });
+}
+
+void MatchingWorker::compactBooks()
+{
+    const uint64_t deadline = rdtsc() + compact_budget_ticks_;
+    for (size_t n = 0; n < books_.size() && rdtsc() < deadline; ++n)
+    {
+        InstrumentBook *book = books_[compact_next_];
+        compact_next_ = (compact_next_ + 1) % books_.size();
+        if (book)
+            book->engine.compact(COMPACT_CHUNK);
+    }
+}
+
+void MatchingWorker::operator()()
+{
+    TRACE_THREAD_NAME("worker " + std::to_string(id_));
+    ENGINE_COUNTERS_THREAD("worker " + std::to_string(id_));
+
+    // a deferred ring is built here, on its consumer, in parallel with the other workers'
+    if (!ring_.ready())
+        ring_.initialise();
+    if (cancels_ && !cancels_->ready())
+        cancels_->initialise();
 
     // Debug: Track worker activity
     uint64_t total_processed = 0;
     uint64_t batch_count = 0;
+    bool idle = false; // inside a traced backoff span
+
+    // Sampled per-stage latency, merged into Stats on exit
+    StageLatency stage_latency;
+    const double ns_per_tick = TscClock::ns_per_tick();
+
+    // Adaptive batch sizing state
+    size_t cur_batch = min_batch_;
+    double ns_per_msg = 0.0; // EWMA of processing cost per message
+    Log2Histogram batch_sizes;
 
     while (true)
     {
+        if (unlikely(dir_.hasInbox(id_)))
+            adoptHandoffs();
+
+        // Batch boundary: the priority lane goes first
+        if (cancels_)
+            drainCancels();
+
         // Check if we should stop
-        if (done_.load(std::memory_order_acquire))
+        if (done_.load(std::memory_order_acquire) && parked_.empty())
         {
             // Producer is done, check if buffer is empty
-            if (ring_.empty())
+            if (ring_.empty() && (!cancels_ || cancels_->empty()))
             {
                 printf("Worker: Producer done and buffer empty, exiting. Processed %llu orders in %llu batches.\n",
                        (unsigned long long)total_processed, (unsigned long long)batch_count);
@@ -40,79 +218,111 @@ void MatchingWorker::operator()()
             }
         }
 
-        // Try to pop a batch of orders for better throughput
-        size_t batch_size = ring_.popBatch(batch.data(), BATCH_SIZE);
+        // Take up to a batch of messages, matched in place in the ring's cells
+        [[maybe_unused]] uint64_t pop_t0 = TRACE_TSC();
+        cur_batch = nextBatchSize(cur_batch, ring_.size(), ns_per_msg);
+        MpscLanes<OrderMsg>::Ticket ticket;
+        const OrderMsg *msg = ring_.peek(ticket);
 
-        if (batch_size == 0)
+        if (msg == nullptr)
         {
             // No orders available, check if we should exit
-            if (done_.load(std::memory_order_acquire) && ring_.empty())
+            if (done_.load(std::memory_order_acquire) && ring_.empty() && parked_.empty() &&
+                (!cancels_ || cancels_->empty()))
             {
                 printf("Worker: No orders available, producer done and buffer empty, exiting. Processed %llu orders in %llu batches.\n",
                        (unsigned long long)total_processed, (unsigned long long)batch_count);
                 break; // Exit if producer is done and buffer is empty
             }
             // Very short yield to reduce CPU usage
+            if (!idle)
+            {
+                TRACE_BEGIN(TraceEvent::Backoff, 0);
+                idle = true;
+            }
             _mm_pause();
             continue;
         }
+        if (idle)
+        {
+            TRACE_END(TraceEvent::Backoff, 0);
+            idle = false;
+        }
+        TRACE_SPAN(TraceEvent::BatchPop, pop_t0, cur_batch);
+        const uint64_t t_pop = rdtsc();
 
         batch_count++;
+        TRACE_BEGIN(TraceEvent::Match, cur_batch);
 
-        // Process the batch efficiently with lightweight simulation
-        for (size_t i = 0; i < batch_size; ++i)
+        // Match the batch against the owned instrument books, releasing each cell once applied
+        size_t batch_size = 0;
+        do
         {
-            const OrderMsg &msg = batch[i];
-            local_popped++;
             total_processed++;
 
-            if (msg.msg_type == MessageType::ADD_ORDER)
-            {
-                // Lightweight order processing - simulate fills based on order characteristics
-                if (msg.qty < 5)
-                {
-                    // Small orders are more likely to be filled immediately
-                    local_donefill++;
-                }
-                else
-                {
-                    // Larger orders rest in book - track them for potential cancellation
-                    uint32_t synthetic_handle = (uint32_t)msg.client_id;
-                    synthetic_to_engine_handle[synthetic_handle] = synthetic_handle; // Simple 1:1 mapping
-                }
-            }
-            else if (msg.msg_type == MessageType::CANCEL_ORDER)
+            const uint64_t t_gen = msg->t_gen;
+            const uint64_t t_push = msg->t_push;
+            // cancels are all stamped, for cancel-to-ack only
+            const uint64_t t_match = (t_gen && msg->msg_type != MessageType::CANCEL_ORDER) ? rdtsc() : 0;
+
+            process(*msg);
+            ring_.release(ticket);
+
+            if (t_match)
             {
-                // Cancel order if it exists in our tracking
-                uint32_t synthetic_handle = msg.handle_to_cancel;
-                auto it = synthetic_to_engine_handle.find(synthetic_handle);
-
-                if (it != synthetic_to_engine_handle.end())
-                {
-                    local_cancels++;
-                    synthetic_to_engine_handle.erase(it);
-                }
-                // If order not found, it was already filled - that's ok
+                const uint64_t t_done = rdtsc();
+                auto ns = [ns_per_tick](uint64_t from, uint64_t to)
+                { return to > from ? (uint64_t)((to - from) * ns_per_tick) : 0; };
+                stage_latency.stages[StageLatency::PUSH_WAIT].record(ns(t_gen, t_push));
+                stage_latency.stages[StageLatency::QUEUEING].record(ns(t_push, t_pop));
+                stage_latency.stages[StageLatency::BATCH_WAIT].record(ns(t_pop, t_match));
+                stage_latency.stages[StageLatency::ENGINE].record(ns(t_match, t_done));
+                stage_latency.stages[StageLatency::END_TO_END].record(ns(t_gen, t_done));
             }
-        }
+        } while (++batch_size < cur_batch && (msg = ring_.peek(ticket)) != nullptr);
+        batch_sizes.record(batch_size);
+        TRACE_END(TraceEvent::Match, batch_size);
+
+        // Top up the pools that ran low so alloc_node never has to grow mid-match. A book handed
+        // over since it was noted belongs to another worker now and is left to it.
+        for (InstrumentBook *book : low_pools_)
+            if (books_[book->id] == book)
+                book->engine.grow_if_low();
+        low_pools_.clear();
+        if (compact_budget_ticks_)
+            compactBooks();
+
+        const double batch_ns = (double)(rdtsc() - t_pop) * ns_per_tick / (double)batch_size;
+        ns_per_msg = (ns_per_msg == 0.0) ? batch_ns : ns_per_msg + 0.125 * (batch_ns - ns_per_msg);
 
         // Update stats less frequently to reduce contention
-        if (local_popped >= 50000)
+        if (local_.popped >= 50000)
         {
-            stats_.popped.fetch_add(local_popped, std::memory_order_relaxed);
-            stats_.donefill.fetch_add(local_donefill, std::memory_order_relaxed);
-            stats_.cancels.fetch_add(local_cancels, std::memory_order_relaxed);
-            stats_.rejected.fetch_add(local_rejected, std::memory_order_relaxed);
-            local_popped = 0;
-            local_donefill = 0;
-            local_cancels = 0;
-            local_rejected = 0;
+            TRACE_BEGIN(TraceEvent::StatsFlush, local_.popped);
+            stats_.popped.fetch_add(local_.popped, std::memory_order_relaxed);
+            stats_.donefill.fetch_add(local_.donefill, std::memory_order_relaxed);
+            stats_.cancels.fetch_add(local_.cancels, std::memory_order_relaxed);
+            stats_.rejected.fetch_add(local_.rejected, std::memory_order_relaxed);
+            stats_.mass_quotes.fetch_add(local_.quote_acks, std::memory_order_relaxed);
+            stats_.quote_sides.fetch_add(local_.quote_sides, std::memory_order_relaxed);
+            stats_.quote_amends.fetch_add(local_.quote_amends, std::memory_order_relaxed);
+            local_ = MatchCounters{};
+            TRACE_END(TraceEvent::StatsFlush, 0);
         }
     }
+    if (idle)
+        TRACE_END(TraceEvent::Backoff, 0);
 
     // Final stats update
-    stats_.popped.fetch_add(local_popped, std::memory_order_relaxed);
-    stats_.donefill.fetch_add(local_donefill, std::memory_order_relaxed);
-    stats_.cancels.fetch_add(local_cancels, std::memory_order_relaxed);
-    stats_.rejected.fetch_add(local_rejected, std::memory_order_relaxed);
+    stats_.popped.fetch_add(local_.popped, std::memory_order_relaxed);
+    stats_.donefill.fetch_add(local_.donefill, std::memory_order_relaxed);
+    stats_.cancels.fetch_add(local_.cancels, std::memory_order_relaxed);
+    stats_.rejected.fetch_add(local_.rejected, std::memory_order_relaxed);
+    stats_.mass_quotes.fetch_add(local_.quote_acks, std::memory_order_relaxed);
+    stats_.quote_sides.fetch_add(local_.quote_sides, std::memory_order_relaxed);
+    stats_.quote_amends.fetch_add(local_.quote_amends, std::memory_order_relaxed);
+    local_ = MatchCounters{};
+    stage_latency.stages[StageLatency::CANCEL_ACK].merge(cancel_ack_);
+    stats_.advanced->mergeStageLatency(stage_latency);
+    stats_.advanced->mergeBatchSizes(id_, batch_sizes);
 }
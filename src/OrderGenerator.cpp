@@ -1,100 +1,143 @@
 #include "OrderGenerator.hpp"
+#include "Trace.hpp"
+#include "Tsc.hpp"
+#include "OrderFlow.hpp"
+#include <string>
 #include <cstring>     // std::strcmp (if you later add CLI here)
 #include <immintrin.h> // _mm_pause (optional)
 
-template <typename T>
-static inline T clampT(T v, T lo, T hi) { return v < lo ? lo : (v > hi ? hi : v); }
-
-OrderGenerator::OrderGenerator(std::vector<AtomicRingBuffer<OrderMsg> *> &rings,
+OrderGenerator::OrderGenerator(std::vector<MpscLanes<OrderMsg> *> &rings,
+                               std::vector<MpscLanes<OrderMsg> *> &cancel_rings,
+                               uint32_t gateway,
+                               uint32_t gateways,
+                               std::atomic<uint32_t> &running,
                                OrderManager &om,
                                const Config &cfg,
                                std::atomic<bool> &done_flag,
-                               Stats &stats)
-    : rings_(rings), om_(om), cfg_(cfg), done_(done_flag), stats_(stats) {}
+                               Stats &stats,
+                               InstrumentDirectory &dir)
+    : rings_(rings), cancel_rings_(cancel_rings), gateway_(gateway), gateways_(gateways ? gateways : 1), running_(running), om_(om), cfg_(cfg), done_(done_flag), stats_(stats), dir_(dir),
+      route_(dir.numInstruments())
+{
+    for (uint32_t i = 0; i < route_.size(); ++i)
+        route_[i] = InstrumentDirectory::homeWorker(i, (uint32_t)rings_.size());
+}
 
-void OrderGenerator::operator()()
+// Hand a migration marker to the instrument's current worker and flip its routing entry.
+// Everything generated after this point goes to the new worker.
+void OrderGenerator::applyMigration(uint32_t instrument, uint32_t to)
 {
-    std::mt19937_64 rng(cfg_.rng_seed);
-    std::uniform_int_distribution<uint32_t> qty_dist(1, cfg_.max_qty);
-    std::uniform_int_distribution<uint32_t> side_dist(0, 1);
-    std::uniform_int_distribution<int32_t> off_dist(-(int32_t)cfg_.span_ticks,
-                                                    (int32_t)cfg_.span_ticks);
+    const uint32_t from = route_[instrument];
+    if (from == to)
+        return;
+
+    OrderMsg msg{};
+    msg.msg_type = MessageType::MIGRATE_OUT;
+    msg.instrument = instrument;
+    msg.worker_id = to; // destination worker
+    while (!rings_[from]->push(gateway_, msg))
+        std::this_thread::yield();
+
+    route_[instrument] = to;
+    ++route_epoch_;
+}
 
-    const uint32_t mid = Config::MAX_TICKS / 2;
+// Route each entry of a mass quote to its instrument's worker and send one message per worker
+// involved, all sharing the entries. Returns the number of ring messages.
+uint32_t OrderGenerator::dispatchMassQuote(OrderMsg &msg)
+{
+    MassQuote *q = msg.quote;
+    std::vector<uint8_t> involved(rings_.size(), 0);
+    uint32_t parts = 0;
+    for (QuoteEntry &e : q->entries)
+    {
+        e.worker = route_[e.instrument];
+        std::atomic<uint64_t> &routed = dir_.book(e.instrument).routed;
+        routed.store(routed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (!involved[e.worker])
+            ++parts;
+        involved[e.worker] = 1;
+    }
+    if (parts == 0)
+    {
+        delete q;
+        return 0;
+    }
+    q->refs.store(parts, std::memory_order_relaxed); // published by the ring push
+
+    for (uint32_t w = 0; w < rings_.size(); ++w)
+    {
+        if (!involved[w])
+            continue;
+        msg.worker_id = w;
+        while (!rings_[w]->push(gateway_, msg))
+            std::this_thread::yield();
+    }
+    return parts;
+}
+
+void OrderGenerator::operator()()
+{
+    TRACE_THREAD_NAME(gateways_ > 1 ? "gateway " + std::to_string(gateway_) : std::string("generator"));
+
+    // Flow over this gateway's instruments; routing decides the worker
+    std::vector<uint32_t> instruments;
+    for (uint32_t i = gateway_; i < route_.size(); i += gateways_)
+        instruments.push_back(i);
+    const uint64_t count = gateways_ == 1 ? cfg_.num_orders
+                           : instruments.empty() ? 0
+                                                 : OrderFlow::partOrders(cfg_, gateway_, gateways_);
+    if (instruments.empty())
+        instruments.push_back(gateway_ % route_.size()); // OrderFlow needs one; no message is made
+    OrderFlow flow(cfg_, instruments, cfg_.rng_seed + gateway_);
 
     // local counters (don't contend with consumer)
     uint64_t generated = 0, pushed = 0;
     uint64_t last_report = 0;
+    uint32_t mig_instrument, mig_to;
 
-    // Track active orders for cancellation - store handles per worker
-    std::vector<std::vector<uint32_t>> active_orders_per_worker(rings_.size());
-
-    for (uint64_t i = 0; i < cfg_.num_orders; ++i)
+    for (uint64_t i = 0; i < count; ++i)
     {
-        const uint8_t side = (uint8_t)side_dist(rng);
-        const uint32_t qty = qty_dist(rng);
-        const int32_t off = off_dist(rng);
-        uint32_t px = clampT<uint32_t>(mid + off, 1, Config::MAX_TICKS - 2);
-
-        // Determine target worker using round-robin
-        uint32_t target_worker = cur_worker_++;
-        if (cur_worker_ >= rings_.size())
-            cur_worker_ = 0;
-
-        OrderMsg msg{};
-        msg.worker_id = target_worker;
-
-        // Decide whether to generate a cancel or new order
-        bool should_cancel = (cfg_.cancel_every > 0) &&
-                             (i % cfg_.cancel_every == 0) &&
-                             (i > 0) &&
-                             (!active_orders_per_worker[target_worker].empty());
-
-        if (should_cancel)
-        {
-            // Generate a cancel message
-            msg.msg_type = MessageType::CANCEL_ORDER;
-
-            // Pick a random active order to cancel from this worker
-            auto &worker_orders = active_orders_per_worker[target_worker];
-            size_t idx = rng() % worker_orders.size();
-            msg.handle_to_cancel = worker_orders[idx];
-
-            // Remove from active list (swap with last element for O(1) removal)
-            worker_orders[idx] = worker_orders.back();
-            worker_orders.pop_back();
-
-            // Set other fields (though they won't be used for cancel)
-            msg.client_id = i + 1;
-            msg.price_tick = px;
-            msg.qty = qty;
-            msg.side = side;
-            msg.flags = 0;
-        }
-        else
+        // Apply pending rebalance between two messages (epoch flip)
+        if (unlikely(dir_.takeMigration(mig_instrument, mig_to, gateway_, gateways_)))
+            applyMigration(mig_instrument, mig_to);
+
+        const bool sampled = cfg_.latency_sample_every && (i % cfg_.latency_sample_every == 0);
+        const uint32_t instrument = flow.prepare(i);
+        const bool cancel = flow.cancelling();
+        const uint64_t t_gen = (sampled || cancel) ? rdtsc() : 0; // every cancel: cancel-to-ack latency
+
+        if (unlikely(instrument == ALL_INSTRUMENTS))
         {
-            // Generate a new order
-            msg.msg_type = MessageType::ADD_ORDER;
-            msg.client_id = i + 1;
-            msg.price_tick = px;
-            msg.qty = qty;
-            msg.side = side;
-            msg.flags = 0;
-            msg.handle_to_cancel = 0; // Not used for add orders
-
-            // We'll add the handle to active_orders when we get it back from the engine
-            // For now, we'll use a synthetic handle based on order sequence
-            uint32_t synthetic_handle = (uint32_t)(i + 1);
-            active_orders_per_worker[target_worker].push_back(synthetic_handle);
+            OrderMsg msg{};
+            msg.t_gen = t_gen;
+            flow.build(msg);
+            ++generated;
+            pushed += dispatchMassQuote(msg);
+            continue;
         }
 
+        // Route symbol-affine so each instrument's messages stay in order on one worker
+        const uint32_t target_worker = route_[instrument];
+        std::atomic<uint64_t> &routed = dir_.book(instrument).routed;
+        routed.store(routed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
         ++generated;
 
-        // Try to push with minimal back-pressure
+        // Claim a cell with minimal back-pressure, then build the message in place. Cancels take
+        // the worker's priority lane when there is one.
         uint32_t retry_count = 0;
-        AtomicRingBuffer<OrderMsg> *target = rings_[target_worker % rings_.size()];
-        while (!target->push(msg))
+        MpscLanes<OrderMsg> *target = (cancel && !cancel_rings_.empty()) ? cancel_rings_[target_worker] : rings_[target_worker];
+        bool backed_off = false;
+        size_t ticket;
+        OrderMsg *msg;
+        while ((msg = target->claim(gateway_, ticket)) == nullptr)
         {
+            if (!backed_off)
+            {
+                TRACE_BEGIN(TraceEvent::ProducerBackoff, target_worker);
+                backed_off = true;
+            }
             retry_count++;
 
             // Report progress every 500K orders (less frequent to reduce overhead)
@@ -117,16 +160,36 @@ void OrderGenerator::operator()()
                 retry_count = 0;
             }
         }
+        *msg = OrderMsg{};
+        msg->t_gen = t_gen;
+        flow.build(*msg);
+        msg->worker_id = target_worker;
+        if (sampled)
+            msg->t_push = rdtsc();
+        target->commit(gateway_, ticket);
+        if (backed_off)
+            TRACE_END(TraceEvent::ProducerBackoff, target_worker);
         ++pushed;
     }
 
     // Update final stats before finishing
-    stats_.generated.store(generated, std::memory_order_release);
-    stats_.pushed.store(pushed, std::memory_order_release);
+    stats_.generated.fetch_add(generated, std::memory_order_release);
+    stats_.pushed.fetch_add(pushed, std::memory_order_release);
 
-    printf("OrderGenerator completed: Generated %llu, Pushed %llu orders\n",
-           (unsigned long long)generated, (unsigned long long)pushed);
+    printf("OrderGenerator %u completed: Generated %llu, Pushed %llu orders (routing epoch %llu)\n", gateway_,
+           (unsigned long long)generated, (unsigned long long)pushed, (unsigned long long)route_epoch_);
 
-    // let consumer know generation is complete
-    done_.store(true, std::memory_order_release);
+    // let consumers know generation is complete once every gateway is; until then keep moving
+    // this gateway's instruments when the rebalancer asks
+    if (running_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        done_.store(true, std::memory_order_release);
+        return;
+    }
+    while (running_.load(std::memory_order_acquire) != 0)
+    {
+        if (dir_.takeMigration(mig_instrument, mig_to, gateway_, gateways_))
+            applyMigration(mig_instrument, mig_to);
+        std::this_thread::yield();
+    }
 }
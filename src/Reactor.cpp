@@ -0,0 +1,229 @@
+#include "Reactor.hpp"
+#include "EngineCounters.hpp"
+#include "OrderFlow.hpp"
+#include "Trace.hpp"
+#include "Tsc.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Pin the calling thread to one core (best effort)
+static void pinToCore(uint32_t core)
+{
+#ifdef __linux__
+    const unsigned n = std::thread::hardware_concurrency();
+    if (n == 0)
+        return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core % n, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)core;
+#endif
+}
+
+// Apply every entry of a mass quote with quoteFn(maker, entry), then acknowledge and free it.
+// A shard owns every instrument its flow quotes, so nothing is ever held back.
+template <typename QuoteFn>
+static void applyMassQuote(const OrderMsg &msg, MatchCounters &local, QuoteFn &&quoteFn)
+{
+    MassQuote *q = msg.quote;
+    local.popped++;
+    for (const QuoteEntry &e : q->entries)
+        quoteFn(q->maker, e);
+    local.quote_acks++;
+    delete q;
+}
+
+ReactorShard::ReactorShard(uint32_t id,
+                           uint32_t num_shards,
+                           InstrumentDirectory *dir,
+                           const Config &cfg,
+                           Stats &stats)
+    : id_(id), num_shards_(num_shards), dir_(dir), cfg_(cfg), stats_(stats) {}
+
+uint64_t ReactorShard::shardOrders(const Config &cfg, uint32_t shard, uint32_t num_shards)
+{
+    // a shard's instruments are its home instruments, instrument % num_shards
+    return OrderFlow::partOrders(cfg, shard, num_shards);
+}
+
+void ReactorShard::operator()()
+{
+    pinToCore(id_);
+    TRACE_THREAD_NAME("shard " + std::to_string(id_));
+    ENGINE_COUNTERS_THREAD("shard " + std::to_string(id_));
+
+    std::vector<uint32_t> owned;
+    for (uint32_t i = 0; i < cfg_.num_instruments; ++i)
+        if (InstrumentDirectory::homeWorker(i, num_shards_) == id_)
+            owned.push_back(i);
+    const uint64_t count = owned.empty() ? 0 : shardOrders(cfg_, id_, num_shards_);
+
+    MatchCounters local;
+    if (count)
+    {
+        if (dir_)
+        {
+            // one full MatchingEngine per instrument
+            std::vector<InstrumentBook *> books(cfg_.num_instruments, nullptr);
+            for (uint32_t i : owned)
+            {
+                books[i] = &dir_->book(i);
+                books[i]->owner_worker.store((int32_t)id_, std::memory_order_relaxed);
+            }
+            uint64_t n = 0;
+            run(owned, count, local, [&](const OrderMsg &msg)
+                {
+                if (unlikely(msg.msg_type == MessageType::MASS_QUOTE))
+                    applyMassQuote(msg, local, [&](uint32_t maker, const QuoteEntry &e)
+                                   { books[e.instrument]->quote(maker, e, local); });
+                else
+                    books[msg.instrument]->apply(msg, local);
+                if ((++n & 0x3FF) == 0)
+                    for (uint32_t i : owned)
+                        books[i]->engine.grow_if_low(); });
+        }
+        else
+        {
+            // all instruments share one pool; each keeps a small ladder centred on mid,
+            // materialised on first activity and compacted again once idle
+            GroupEngine group((uint32_t)owned.size(), Config::MAX_TICKS / 2 - Config::GROUP_LADDER_TICKS / 2);
+            HandleTracker tracker;
+            std::vector<uint32_t> slot(cfg_.num_instruments, 0);
+            for (uint32_t b = 0; b < owned.size(); ++b)
+                slot[owned[b]] = b;
+            const uint32_t makers = cfg_.num_makers ? cfg_.num_makers : 1;
+            std::vector<QuoteSlot> quotes(cfg_.mass_quote_every ? owned.size() * makers : 0); // [book][maker]
+            uint64_t n = 0;
+            run(owned, count, local, [&](const OrderMsg &msg)
+                {
+                if (unlikely(msg.msg_type == MessageType::MASS_QUOTE))
+                    applyMassQuote(msg, local, [&](uint32_t maker, const QuoteEntry &e)
+                                   {
+                        const uint32_t b = slot[e.instrument];
+                        auto book = group.book(b);
+                        applyQuote(book, tracker, quotes[b * makers + maker], maker, b, e, local); });
+                else
+                {
+                    auto book = group.book(slot[msg.instrument]);
+                    applyMessage(book, tracker, msg, local);
+                }
+                if ((++n & 0x3FF) == 0)
+                    group.grow_if_low();
+                if ((n & 0xFFFF) == 0)
+                    group.evict_idle(cfg_.cold_book_idle_ops); });
+            printf("Shard %u: %u live books, %zu ladders allocated, %llu materialised, %llu evicted\n",
+                   id_, group.live_books(), group.ladders_allocated(),
+                   (unsigned long long)group.materialisations(), (unsigned long long)group.evictions());
+        }
+    }
+
+    // No ring in between: every generated message is "pushed" and processed locally
+    stats_.generated.fetch_add(count, std::memory_order_relaxed);
+    stats_.pushed.fetch_add(count, std::memory_order_relaxed);
+    flush(local);
+
+    printf("Shard %u: processed %llu orders on %zu instruments\n",
+           id_, (unsigned long long)count, owned.size());
+}
+
+void ReactorShard::flush(MatchCounters &local)
+{
+    TRACE_BEGIN(TraceEvent::StatsFlush, local.popped);
+    stats_.popped.fetch_add(local.popped, std::memory_order_relaxed);
+    stats_.donefill.fetch_add(local.donefill, std::memory_order_relaxed);
+    stats_.cancels.fetch_add(local.cancels, std::memory_order_relaxed);
+    stats_.rejected.fetch_add(local.rejected, std::memory_order_relaxed);
+    stats_.mass_quotes.fetch_add(local.quote_acks, std::memory_order_relaxed);
+    stats_.quote_sides.fetch_add(local.quote_sides, std::memory_order_relaxed);
+    stats_.quote_amends.fetch_add(local.quote_amends, std::memory_order_relaxed);
+    local = MatchCounters{};
+    TRACE_END(TraceEvent::StatsFlush, 0);
+}
+
+template <typename ApplyFn>
+void ReactorShard::run(const std::vector<uint32_t> &owned, uint64_t count, MatchCounters &local, ApplyFn &&apply)
+{
+    StageLatency stage_latency;
+    const double ns_per_tick = TscClock::ns_per_tick();
+
+    OrderFlow flow(cfg_, owned, cfg_.rng_seed + id_);
+    for (uint64_t seq = 0; seq < count; ++seq)
+    {
+        OrderMsg msg{};
+        const bool sampled = cfg_.latency_sample_every && (seq % cfg_.latency_sample_every == 0);
+        const uint64_t t_gen = sampled ? rdtsc() : 0;
+
+        flow.next(seq, msg);
+        msg.worker_id = id_;
+
+        const uint64_t t_match = sampled ? rdtsc() : 0;
+        apply(msg);
+
+        if (sampled)
+        {
+            const uint64_t t_done = rdtsc();
+            stage_latency.stages[StageLatency::ENGINE].record((uint64_t)((t_done - t_match) * ns_per_tick));
+            stage_latency.stages[StageLatency::END_TO_END].record((uint64_t)((t_done - t_gen) * ns_per_tick));
+        }
+
+        if (local.popped >= 50000)
+            flush(local);
+    }
+    stats_.advanced->mergeStageLatency(stage_latency);
+}
+
+void runReactor(const Config &cfg, Stats &stats, int num_shards)
+{
+    stats.launch();
+
+    // Full per-instrument engines unless the shards host their books in shared-pool groups
+    std::unique_ptr<InstrumentDirectory> directory;
+    if (!cfg.shared_pool)
+    {
+        directory = std::make_unique<InstrumentDirectory>(cfg.num_instruments, (uint32_t)num_shards);
+        directory->enableQueuePosition(cfg.queue_position_instruments);
+        if (cfg.preload_orders)
+        {
+            const auto t0 = std::chrono::steady_clock::now();
+            const uint64_t loaded = directory->preload(cfg.preload_orders, cfg.span_ticks, cfg.max_qty);
+            printf("Reactor: %llu resting orders preloaded in %.2f ms\n", (unsigned long long)loaded,
+                   std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+        }
+        directory->linkSpreads(cfg.spreads);
+    }
+    else
+        printf("Reactor: shared-pool engine groups, %zu bytes per instrument book\n", GroupEngine::book_bytes());
+
+    std::vector<ReactorShard> shards;
+    shards.reserve(num_shards);
+    for (int i = 0; i < num_shards; ++i)
+        shards.emplace_back((uint32_t)i, (uint32_t)num_shards, directory.get(), cfg, stats);
+
+    stats.start();
+    std::vector<std::thread> threads;
+    for (auto &s : shards)
+        threads.emplace_back(std::ref(s));
+    for (auto &t : threads)
+        t.join();
+    stats.stop();
+
+    if (directory)
+    {
+        uint64_t implied_trades, implied_volume;
+        directory->impliedTotals(implied_trades, implied_volume);
+        stats.implied_trades.store(implied_trades);
+        stats.dark_trades.store(directory->darkTrades());
+        stats.book_hash.store(directory->bookHash());
+        const auto poc = directory->volumeSummary(0);
+        stats.hot_poc_tick.store(poc.poc);
+        stats.hot_poc_volume.store(poc.poc_volume);
+    }
+}
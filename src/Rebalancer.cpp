@@ -0,0 +1,86 @@
+#include "Rebalancer.hpp"
+#include <chrono>
+#include <thread>
+
+RebalanceController::RebalanceController(InstrumentDirectory &dir,
+                                         const Config &cfg,
+                                         std::atomic<bool> &done_flag,
+                                         Stats &stats)
+    : dir_(dir), cfg_(cfg), done_(done_flag), stats_(stats),
+      assignment_(dir.numInstruments()), last_msgs_(dir.numInstruments(), 0)
+{
+    for (uint32_t i = 0; i < dir_.numInstruments(); ++i)
+        assignment_[i] = InstrumentDirectory::homeWorker(i, dir_.numWorkers());
+}
+
+void RebalanceController::operator()()
+{
+    const uint32_t num_instruments = dir_.numInstruments();
+    const uint32_t num_workers = dir_.numWorkers();
+    std::vector<uint64_t> inst_load(num_instruments);
+    std::vector<uint64_t> worker_load(num_workers);
+
+    int64_t inflight = -1; // instrument being moved, until the new owner adopts it
+
+    while (!done_.load(std::memory_order_acquire))
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(cfg_.rebalance_interval_ms));
+
+        // sample offered message rates over the last interval
+        std::fill(worker_load.begin(), worker_load.end(), 0);
+        for (uint32_t i = 0; i < num_instruments; ++i)
+        {
+            const uint64_t m = dir_.book(i).routed.load(std::memory_order_relaxed);
+            inst_load[i] = m - last_msgs_[i];
+            last_msgs_[i] = m;
+            worker_load[assignment_[i]] += inst_load[i];
+        }
+
+        if (inflight >= 0)
+        {
+            if (dir_.book((uint32_t)inflight).owner_worker.load(std::memory_order_acquire) != (int32_t)assignment_[inflight])
+                continue; // previous move not finished yet
+            inflight = -1;
+        }
+
+        uint32_t hot = 0, cold = 0;
+        for (uint32_t w = 1; w < num_workers; ++w)
+        {
+            if (worker_load[w] > worker_load[hot])
+                hot = w;
+            if (worker_load[w] < worker_load[cold])
+                cold = w;
+        }
+        const uint64_t gap = worker_load[hot] - worker_load[cold];
+        if (hot == cold || worker_load[hot] == 0 ||
+            (double)worker_load[hot] < cfg_.rebalance_threshold * (double)(worker_load[cold] + 1))
+            continue;
+
+        // move the instrument whose load best halves the gap; moving anything larger
+        // than the gap would only swap which worker is hot
+        int64_t pick = -1;
+        uint64_t best_err = ~0ull;
+        for (uint32_t i = 0; i < num_instruments; ++i)
+        {
+            if (assignment_[i] != hot || inst_load[i] == 0 || inst_load[i] >= gap)
+                continue;
+            if (dir_.book(i).implied) // spread legs stay together on their home worker
+                continue;
+            const uint64_t half = gap / 2;
+            const uint64_t err = inst_load[i] > half ? inst_load[i] - half : half - inst_load[i];
+            if (err < best_err)
+            {
+                best_err = err;
+                pick = i;
+            }
+        }
+        if (pick < 0 || !dir_.requestMigration((uint32_t)pick, cold))
+            continue;
+
+        printf("Rebalancer: moving instrument %lld from worker %u to worker %u (load %llu vs %llu)\n",
+               (long long)pick, hot, cold, (unsigned long long)worker_load[hot], (unsigned long long)worker_load[cold]);
+        assignment_[pick] = cold;
+        inflight = pick;
+        stats_.migrations.fetch_add(1, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,28 @@
+// BookTest.hpp
+#pragma once
+#include <cstdint>
+#include <memory>
+#include "EngineGroup.hpp"
+#include "MatchingEngine.hpp"
+
+// Small single-instrument engine and order helpers shared by the engine tests
+using TestEngine = MatchingEngine<256, 1u << 16>;
+
+inline std::unique_ptr<TestEngine> make_engine() { return std::make_unique<TestEngine>(); }
+
+// Many such books on one shared pool
+using TestGroup = EngineGroup<256, 1u << 16>;
+
+inline OrderIn limit(uint8_t side, uint32_t tick, uint32_t qty, uint8_t flags = 0, uint32_t min_qty = 0) {
+    OrderIn in{.client_id=0,.price_tick=tick,.qty=qty,.side=side,.flags=flags};
+    in.min_qty = min_qty;
+    return in;
+}
+
+inline OrderIn peg(uint8_t side, uint8_t kind, uint32_t qty, uint8_t offset = 0, uint32_t min_qty = 0) {
+    OrderIn in{.client_id=0,.price_tick=0,.qty=qty,.side=side,.flags=0};
+    in.peg = kind;
+    in.peg_offset = offset;
+    in.min_qty = min_qty;
+    return in;
+}
@@ -0,0 +1,80 @@
+// Compaction moves nodes but must never change what the book does: a compacted and an
+// uncompacted engine fed the same orders stay identical
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+#include "BookTest.hpp"
+
+namespace {
+
+void expect_same(const TestEngine& a, const TestEngine& b) {
+    ASSERT_EQ(a.state_hash(), b.state_hash());
+    ASSERT_EQ(a.total_trades(), b.total_trades());
+    ASSERT_EQ(a.total_volume(), b.total_volume());
+    ASSERT_EQ(a.best_bid(), b.best_bid());
+    ASSERT_EQ(a.best_ask(), b.best_ask());
+    ASSERT_EQ(a.best_bid_qty(), b.best_bid_qty());
+    ASSERT_EQ(a.best_ask_qty(), b.best_ask_qty());
+}
+
+} // namespace
+
+TEST(Compact, DifferentialRandomFlow) {
+    auto plain = make_engine();
+    auto compacted = make_engine();
+    std::mt19937 rng(12345);
+    std::vector<uint32_t> live;
+    uint64_t moved = 0;
+
+    for (uint32_t step = 0; step < 200000; ++step) {
+        const uint32_t op = rng() % 100;
+        if (op < 30 && !live.empty()) {
+            const size_t k = rng() % live.size();
+            const uint32_t h = live[k];
+            live[k] = live.back();
+            live.pop_back();
+            ASSERT_EQ(plain->cancel(h), compacted->cancel(h));
+        } else if (op < 33 && !live.empty()) {
+            const uint32_t h = live[rng() % live.size()];
+            ASSERT_EQ(plain->amend(h, 100, 1), compacted->amend(h, 100, 1));
+        } else {
+            const uint8_t side = rng() % 2;
+            const uint32_t tick = side == SIDE_BUY ? 90 + rng() % 12 : 99 + rng() % 12;
+            uint8_t flags = 0;
+            uint32_t min_qty = 0;
+            const uint32_t kind = rng() % 50;
+            if (kind == 0) flags = ORDER_IOC;
+            else if (kind == 1) flags = ORDER_HIDDEN;
+            else if (kind == 2) min_qty = 3;
+            OrderIn in = limit(side, tick, 1 + rng() % 8, flags, min_qty);
+            if (kind == 3) in = peg(side, PEG_PRIMARY, 1 + rng() % 4, rng() % 3);
+            const uint32_t a = plain->add_limit(in);
+            const uint32_t b = compacted->add_limit(in);
+            ASSERT_EQ(a, b);
+            if (a != TestEngine::NIL && a != TestEngine::DONE_FILL) live.push_back(a);
+        }
+        if (step % 16 == 0) moved += compacted->compact(64);
+        expect_same(*plain, *compacted);
+    }
+    EXPECT_GT(moved, 0u);
+}
+
+TEST(Compact, DeepLevelIsCompactedInChunks) {
+    auto eng = make_engine();
+    // 1000 orders at 100 interleaved with orders at 101 that are then cancelled: a scattered FIFO
+    std::vector<uint32_t> deep, gaps;
+    for (uint32_t i = 0; i < 1000; ++i) {
+        deep.push_back(eng->add_limit(limit(SIDE_SELL, 100, 1)));
+        gaps.push_back(eng->add_limit(limit(SIDE_SELL, 101, 1)));
+    }
+    for (uint32_t h : gaps) ASSERT_TRUE(eng->cancel(h));
+
+    uint64_t moved = 0;
+    for (uint32_t visit = 0; visit < 1000; ++visit) moved += eng->compact(64);
+    EXPECT_GE(moved, 1000u); // the whole level, 64 nodes per visit
+    for (uint32_t visit = 0; visit < 100; ++visit) EXPECT_EQ(eng->compact(64), 0u);
+
+    // FIFO order is unchanged: a buy for 500 fills the first 500 orders
+    EXPECT_EQ(eng->add_limit(limit(SIDE_BUY, 100, 500)), TestEngine::DONE_FILL);
+    for (uint32_t i = 0; i < 1000; ++i) EXPECT_EQ(eng->cancel(deep[i]), i >= 500) << i;
+}
@@ -0,0 +1,77 @@
+// Dark midpoint book: dark orders cross only with each other, at the lit midpoint
+#include <gtest/gtest.h>
+#include "BookTest.hpp"
+#include "EngineGroup.hpp"
+
+TEST(Dark, CrossesAtLitMidpoint) {
+    auto eng = make_engine();
+    eng->add_limit(limit(SIDE_BUY, 40, 1));
+    eng->add_limit(limit(SIDE_SELL, 50, 1));
+    eng->add_limit(peg(SIDE_BUY, PEG_DARK, 10));
+    EXPECT_EQ(eng->add_limit(peg(SIDE_SELL, PEG_DARK, 6)), TestEngine::DONE_FILL);
+
+    EXPECT_EQ(eng->dark_trades(), 1u);
+    EXPECT_EQ(eng->dark_volume(), 6u);
+    EXPECT_EQ(eng->profile().volume_at(45), 6u);
+    EXPECT_EQ(eng->best_bid_qty(), 1u);
+    EXPECT_EQ(eng->best_ask_qty(), 1u);
+}
+
+TEST(Dark, HonoursMinimumFill) {
+    auto eng = make_engine();
+    eng->add_limit(limit(SIDE_BUY, 40, 1));
+    eng->add_limit(limit(SIDE_SELL, 50, 1));
+    eng->add_limit(peg(SIDE_BUY, PEG_DARK, 10, 0, 8));
+    eng->add_limit(peg(SIDE_SELL, PEG_DARK, 5));
+    EXPECT_EQ(eng->dark_trades(), 0u);
+
+    // 9 meets the minimum; the buy's last 1 then accepts the resting 5
+    eng->add_limit(peg(SIDE_SELL, PEG_DARK, 9));
+    EXPECT_EQ(eng->dark_trades(), 2u);
+    EXPECT_EQ(eng->dark_volume(), 10u);
+}
+
+TEST(Dark, WaitsForTwoSidedLitBook) {
+    auto eng = make_engine();
+    eng->add_limit(peg(SIDE_BUY, PEG_DARK, 5));
+    eng->add_limit(peg(SIDE_SELL, PEG_DARK, 5));
+    eng->add_limit(limit(SIDE_BUY, 40, 1));
+    EXPECT_EQ(eng->dark_trades(), 0u);
+    eng->add_limit(limit(SIDE_SELL, 50, 1));
+    EXPECT_EQ(eng->dark_trades(), 1u);
+    EXPECT_EQ(eng->profile().volume_at(45), 5u);
+}
+
+TEST(Dark, ResetClearsDarkStats) {
+    auto eng = make_engine();
+    eng->add_limit(limit(SIDE_BUY, 40, 1));
+    eng->add_limit(limit(SIDE_SELL, 50, 1));
+    eng->add_limit(peg(SIDE_BUY, PEG_DARK, 5));
+    eng->add_limit(peg(SIDE_SELL, PEG_DARK, 5));
+    ASSERT_EQ(eng->dark_trades(), 1u);
+    eng->reset();
+    EXPECT_EQ(eng->dark_trades(), 0u);
+    EXPECT_EQ(eng->dark_volume(), 0u);
+}
+
+// A ladder given back by an evicted book must not carry its dark counts to the next book
+TEST(Dark, GroupKeepsDarkStatsPerBook) {
+    EngineGroup<256, 1u << 16> group(3, 0);
+    group.add_limit(0, limit(SIDE_BUY, 40, 1));
+    group.add_limit(0, limit(SIDE_SELL, 50, 1));
+    group.add_limit(0, peg(SIDE_BUY, PEG_DARK, 5));
+    group.add_limit(0, peg(SIDE_SELL, PEG_DARK, 5));
+    ASSERT_EQ(group.dark_trades(0), 1u);
+    group.add_limit(1, limit(SIDE_BUY, 40, 1));
+
+    ASSERT_EQ(group.evict_idle(0), 1u); // book 0 only: book 1 was used last
+    EXPECT_EQ(group.dark_volume(0), 5u); // from the image
+    group.add_limit(2, limit(SIDE_BUY, 40, 1)); // takes book 0's ladder
+    EXPECT_EQ(group.ladders_allocated(), 2u);
+    EXPECT_EQ(group.dark_trades(2), 0u);
+    EXPECT_EQ(group.dark_volume(2), 0u);
+
+    group.add_limit(0, limit(SIDE_BUY, 41, 1)); // restored into a new ladder
+    EXPECT_EQ(group.dark_trades(0), 1u);
+    EXPECT_EQ(group.dark_volume(0), 5u);
+}
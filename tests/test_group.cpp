@@ -0,0 +1,124 @@
+// Many small books sharing one order pool: handles, tick rebasing and the ladder window
+#include <gtest/gtest.h>
+#include "BookTest.hpp"
+
+namespace {
+
+constexpr uint32_t BASE = 1000; // absolute tick of every book's ladder slot 0
+
+} // namespace
+
+TEST(Group, BooksShareThePoolButNotTheirOrders) {
+    TestGroup group(3, BASE);
+    const uint32_t a = group.add_limit(0, limit(SIDE_BUY, 1050, 10));
+    const uint32_t b = group.add_limit(1, limit(SIDE_BUY, 1050, 10));
+    ASSERT_NE(a, TestGroup::NIL);
+    ASSERT_NE(b, TestGroup::NIL);
+    EXPECT_NE(a, b); // one handle space for the whole group
+
+    // a sell on book 2 meets nothing: the bids rest on other books
+    const uint32_t s = group.add_limit(2, limit(SIDE_SELL, 1050, 5));
+    ASSERT_NE(s, TestGroup::DONE_FILL);
+    EXPECT_EQ(group.total_trades(2), 0u);
+
+    EXPECT_EQ(group.add_limit(1, limit(SIDE_SELL, 1050, 10)), TestGroup::DONE_FILL);
+    EXPECT_EQ(group.total_volume(1), 10u);
+    EXPECT_EQ(group.total_volume(0), 0u);
+    EXPECT_FALSE(group.cancel(b));
+
+    // cancel finds each handle's own book
+    EXPECT_TRUE(group.cancel(a));
+    EXPECT_EQ(group.best_bid(0), TestGroup::NO_PRICE);
+    EXPECT_EQ(group.state_hash(0), 0u);
+    EXPECT_EQ(group.best_ask(2), 1050u);
+    EXPECT_TRUE(group.cancel(s));
+    EXPECT_FALSE(group.cancel(s));
+}
+
+TEST(Group, PricesAreRebasedToTheLadder) {
+    TestGroup group(1, BASE);
+    group.add_limit(0, limit(SIDE_BUY, 1040, 5));
+    group.add_limit(0, limit(SIDE_SELL, 1060, 5));
+    EXPECT_EQ(group.best_bid(0), 1040u);
+    EXPECT_EQ(group.best_ask(0), 1060u);
+
+    EXPECT_EQ(group.add_limit(0, limit(SIDE_BUY, 1060, 2)), TestGroup::DONE_FILL);
+    const auto sum = group.volume_summary(0, 1000, 1100);
+    EXPECT_EQ(sum.volume, 2u);
+    EXPECT_EQ(sum.poc, 1060u);
+    EXPECT_EQ(group.volume_summary(0, 1061, 1100).volume, 0u);
+}
+
+TEST(Group, PricesOutsideTheWindowAreRejected) {
+    TestGroup group(1, BASE);
+    EXPECT_EQ(group.add_limit(0, limit(SIDE_BUY, BASE - 1, 5)), TestGroup::NIL);
+    EXPECT_EQ(group.add_limit(0, limit(SIDE_SELL, BASE + 256, 5)), TestGroup::NIL);
+    EXPECT_EQ(group.add_limit(0, limit(SIDE_BUY, 0, 5)), TestGroup::NIL);
+    EXPECT_EQ(group.live_books(), 0u); // a rejected order does not materialise the book
+
+    EXPECT_NE(group.add_limit(0, limit(SIDE_BUY, BASE, 5)), TestGroup::NIL);
+    EXPECT_NE(group.add_limit(0, limit(SIDE_SELL, BASE + 255, 5)), TestGroup::NIL);
+    EXPECT_EQ(group.best_bid(0), BASE);
+    EXPECT_EQ(group.best_ask(0), BASE + 255);
+}
+
+TEST(Group, BookRefActsLikeAnEngine) {
+    TestGroup group(2, BASE);
+    auto book = group.book(1);
+    const uint32_t h = book.add_limit(limit(SIDE_SELL, 1010, 8));
+    EXPECT_EQ(book.best_ask(), 1010u);
+    const uint32_t moved = book.requote(h, SIDE_SELL, 1012, 8);
+    ASSERT_NE(moved, TestGroup::NIL);
+    EXPECT_EQ(book.best_ask(), 1012u);
+    EXPECT_FALSE(book.cancel(h));
+    EXPECT_TRUE(book.cancel(moved));
+    EXPECT_EQ(group.best_ask(0), TestGroup::NO_PRICE);
+}
+
+// Idle books are compacted to an image and restored on their next order
+TEST(Group, EvictedBookRoundTripsThroughItsImage) {
+    TestGroup group(2, BASE);
+    const uint32_t first = group.add_limit(0, limit(SIDE_BUY, 1040, 5));
+    const uint32_t second = group.add_limit(0, limit(SIDE_BUY, 1040, 3));
+    group.add_limit(0, limit(SIDE_SELL, 1060, 4));
+    EXPECT_EQ(group.add_limit(0, limit(SIDE_BUY, 1060, 1)), TestGroup::DONE_FILL);
+    const uint64_t hash = group.state_hash(0);
+    ASSERT_NE(hash, 0u);
+
+    group.add_limit(1, limit(SIDE_SELL, 1100, 1)); // book 1 is now the most recently used
+    EXPECT_EQ(group.live_books(), 2u);
+    EXPECT_EQ(group.materialisations(), 2u);
+    ASSERT_EQ(group.evict_idle(0), 1u);
+    EXPECT_EQ(group.live_books(), 1u);
+    EXPECT_EQ(group.evictions(), 1u);
+
+    // queries answer from the image without materialising the book
+    EXPECT_EQ(group.state_hash(0), hash);
+    EXPECT_EQ(group.best_bid(0), 1040u);
+    EXPECT_EQ(group.best_ask(0), 1060u);
+    EXPECT_EQ(group.total_trades(0), 1u);
+    EXPECT_EQ(group.volume_summary(0, BASE, BASE + 256).poc, 1060u);
+    EXPECT_EQ(group.materialisations(), 2u);
+
+    // an order that changes nothing brings the same book back
+    EXPECT_EQ(group.add_limit(0, limit(SIDE_BUY, 1000, 1, ORDER_IOC)), TestGroup::NIL);
+    EXPECT_EQ(group.materialisations(), 3u);
+    EXPECT_EQ(group.ladders_allocated(), 2u); // the evicted ladder was reused
+    EXPECT_EQ(group.state_hash(0), hash);
+    EXPECT_EQ(group.total_volume(0), 1u);
+
+    // FIFO order survived: the first bid trades first
+    EXPECT_EQ(group.add_limit(0, limit(SIDE_SELL, 1040, 5)), TestGroup::DONE_FILL);
+    EXPECT_FALSE(group.cancel(first));
+    EXPECT_TRUE(group.cancel(second));
+}
+
+TEST(Group, OnlyIdleBooksAreEvicted) {
+    TestGroup group(4, BASE);
+    for (uint32_t b = 0; b < 4; ++b) group.add_limit(b, limit(SIDE_BUY, 1010 + b, 1));
+    group.add_limit(0, limit(SIDE_BUY, 1010, 1)); // book 0 used last
+    EXPECT_EQ(group.evict_idle(1), 2u);           // books 1 and 2; book 3 was used one op ago
+    EXPECT_EQ(group.live_books(), 2u);
+    EXPECT_EQ(group.evict_idle(100), 0u);
+    for (uint32_t b = 0; b < 4; ++b) EXPECT_EQ(group.best_bid(b), 1010 + b);
+}
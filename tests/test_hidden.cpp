@@ -0,0 +1,90 @@
+// Hidden orders rest behind a level's displayed queue; post-only orders never take liquidity
+#include <gtest/gtest.h>
+#include "BookTest.hpp"
+
+TEST(Hidden, TradesAfterDisplayedAtSamePrice) {
+    auto eng = make_engine();
+    const uint32_t shown = eng->add_limit(limit(SIDE_SELL, 100, 5));
+    const uint32_t hidden = eng->add_limit(limit(SIDE_SELL, 100, 5, ORDER_HIDDEN));
+    EXPECT_EQ(eng->best_ask_qty(), 5u);
+
+    EXPECT_EQ(eng->add_limit(limit(SIDE_BUY, 100, 8)), TestEngine::DONE_FILL);
+    EXPECT_EQ(eng->total_trades(), 2u);
+    EXPECT_FALSE(eng->cancel(shown));
+    EXPECT_TRUE(eng->cancel(hidden));
+    EXPECT_EQ(eng->state_hash(), 0u);
+}
+
+TEST(Hidden, HiddenOnlyLevelIsNotPublished) {
+    auto eng = make_engine();
+    eng->add_limit(limit(SIDE_SELL, 100, 5, ORDER_HIDDEN));
+    eng->add_limit(limit(SIDE_SELL, 102, 1));
+    EXPECT_EQ(eng->best_ask(), 102u);
+    EXPECT_EQ(eng->add_limit(limit(SIDE_BUY, 100, 5)), TestEngine::DONE_FILL);
+    EXPECT_EQ(eng->profile().volume_at(100), 5u);
+}
+
+TEST(Hidden, PostOnlyRejectsOrSlides) {
+    auto eng = make_engine();
+    eng->add_limit(limit(SIDE_SELL, 100, 5));
+    EXPECT_EQ(eng->add_limit(limit(SIDE_BUY, 100, 5, ORDER_POST_ONLY)), TestEngine::NIL);
+    const uint32_t h = eng->add_limit(limit(SIDE_BUY, 101, 5, ORDER_POST_SLIDE));
+    ASSERT_NE(h, TestEngine::NIL);
+    EXPECT_EQ(eng->best_bid(), 99u);
+    EXPECT_EQ(eng->total_trades(), 0u);
+}
+
+TEST(Hidden, PostOnlySeesHiddenLiquidity) {
+    auto eng = make_engine();
+    eng->add_limit(limit(SIDE_SELL, 100, 5, ORDER_HIDDEN));
+    EXPECT_EQ(eng->add_limit(limit(SIDE_BUY, 100, 5, ORDER_POST_ONLY)), TestEngine::NIL);
+    EXPECT_EQ(eng->total_trades(), 0u);
+}
+
+// The displayed queue empties while hidden orders keep the level: its queue index must restart
+TEST(Hidden, QueueIndexRestartsAfterSweepOverHidden) {
+    auto eng = make_engine();
+    ASSERT_TRUE(eng->enable_queue_position(true));
+    eng->add_limit(limit(SIDE_SELL, 100, 5));
+    eng->add_limit(limit(SIDE_SELL, 100, 5, ORDER_HIDDEN));
+    EXPECT_EQ(eng->add_limit(limit(SIDE_BUY, 100, 5, ORDER_IOC)), TestEngine::DONE_FILL);
+
+    const uint32_t h = eng->add_limit(limit(SIDE_SELL, 100, 3));
+    EXPECT_EQ(eng->queue_ahead(h), 0u);
+}
+
+TEST(Hidden, QueueIndexRestartsAfterCancelOverHidden) {
+    auto eng = make_engine();
+    ASSERT_TRUE(eng->enable_queue_position(true));
+    const uint32_t shown = eng->add_limit(limit(SIDE_SELL, 100, 5));
+    eng->add_limit(limit(SIDE_SELL, 100, 5, ORDER_HIDDEN));
+    EXPECT_TRUE(eng->cancel(shown));
+
+    const uint32_t h = eng->add_limit(limit(SIDE_SELL, 100, 3));
+    EXPECT_EQ(eng->queue_ahead(h), 0u);
+    const uint32_t next = eng->add_limit(limit(SIDE_SELL, 100, 2));
+    EXPECT_EQ(eng->queue_ahead(next), 3u);
+}
+
+// An evicted book answers price queries from its image: hidden levels stay unpublished there too
+TEST(Hidden, EvictedBookKeepsHiddenPriceUnpublished) {
+    TestGroup group(2, 1000);
+    group.add_limit(0, limit(SIDE_SELL, 1100, 5, ORDER_HIDDEN));
+    group.add_limit(0, limit(SIDE_SELL, 1105, 5));
+    group.add_limit(0, limit(SIDE_BUY, 1090, 5, ORDER_HIDDEN));
+    group.add_limit(0, limit(SIDE_BUY, 1080, 5));
+    EXPECT_EQ(group.best_ask(0), 1105u);
+    EXPECT_EQ(group.best_bid(0), 1080u);
+    const uint64_t hash = group.state_hash(0);
+
+    group.add_limit(1, limit(SIDE_BUY, 1000, 1));
+    ASSERT_EQ(group.evict_idle(0), 1u);
+    EXPECT_EQ(group.state_hash(0), hash);
+    EXPECT_EQ(group.best_ask(0), 1105u);
+    EXPECT_EQ(group.best_bid(0), 1080u);
+
+    // restored, the hidden sell still trades first
+    EXPECT_EQ(group.add_limit(0, limit(SIDE_BUY, 1100, 5)), TestEngine::DONE_FILL);
+    EXPECT_EQ(group.best_ask(0), 1105u);
+    EXPECT_NE(group.state_hash(0), hash);
+}
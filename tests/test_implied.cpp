@@ -0,0 +1,106 @@
+// Implied matching between a calendar spread and its two legs
+#include <gtest/gtest.h>
+#include "BookTest.hpp"
+#include "ImpliedSpread.hpp"
+
+namespace {
+
+using Implied = ImpliedSpread<TestEngine>;
+constexpr uint32_t CENTER = 128;
+
+struct Legs {
+    std::unique_ptr<TestEngine> front = make_engine();
+    std::unique_ptr<TestEngine> back = make_engine();
+    std::unique_ptr<TestEngine> spread = make_engine();
+    Implied im{*front, *back, *spread, CENTER, 256};
+};
+
+} // namespace
+
+TEST(Implied, OutrightBuyTakesImpliedOffer) {
+    Legs l;
+    l.im.add_limit(Implied::BACK, limit(SIDE_SELL, 100, 10));
+    l.im.add_limit(Implied::SPREAD, limit(SIDE_SELL, CENTER, 10));
+    EXPECT_EQ(l.im.implied_price(Implied::FRONT, SIDE_SELL), 100u);
+
+    EXPECT_EQ(l.im.add_limit(Implied::FRONT, limit(SIDE_BUY, 100, 10)), TestEngine::DONE_FILL);
+    EXPECT_EQ(l.im.implied_trades(), 1u);
+    EXPECT_EQ(l.im.implied_volume(), 10u);
+    EXPECT_EQ(l.back->best_ask(), TestEngine::NO_PRICE);
+    EXPECT_EQ(l.spread->best_ask(), TestEngine::NO_PRICE);
+    EXPECT_EQ(l.front->best_bid(), TestEngine::NO_PRICE);
+}
+
+TEST(Implied, EveryLegCountsItsFill) {
+    Legs l;
+    l.im.add_limit(Implied::BACK, limit(SIDE_SELL, 100, 10));
+    l.im.add_limit(Implied::SPREAD, limit(SIDE_SELL, CENTER + 2, 10));
+    EXPECT_EQ(l.im.add_limit(Implied::FRONT, limit(SIDE_BUY, 102, 7)), TestEngine::DONE_FILL);
+
+    for (const TestEngine* book : {l.front.get(), l.back.get(), l.spread.get()}) {
+        EXPECT_EQ(book->total_trades(), 1u);
+        EXPECT_EQ(book->total_volume(), 7u);
+    }
+    EXPECT_EQ(l.front->profile().volume_at(102), 7u);
+    EXPECT_EQ(l.back->profile().volume_at(100), 7u);
+    EXPECT_EQ(l.spread->profile().volume_at(CENTER + 2), 7u);
+}
+
+TEST(Implied, DisplayedLiquidityAtSamePriceGoesFirst) {
+    Legs l;
+    l.im.add_limit(Implied::FRONT, limit(SIDE_SELL, 100, 4));
+    l.im.add_limit(Implied::BACK, limit(SIDE_SELL, 100, 10));
+    l.im.add_limit(Implied::SPREAD, limit(SIDE_SELL, CENTER, 10));
+
+    EXPECT_EQ(l.im.add_limit(Implied::FRONT, limit(SIDE_BUY, 100, 10)), TestEngine::DONE_FILL);
+    EXPECT_EQ(l.im.implied_volume(), 6u);
+    EXPECT_EQ(l.front->total_volume(), 10u);
+    EXPECT_EQ(l.back->best_ask_qty(), 4u);
+    EXPECT_EQ(l.front->best_ask(), TestEngine::NO_PRICE);
+}
+
+TEST(Implied, SpreadSellTakesImpliedBid) {
+    Legs l;
+    l.im.add_limit(Implied::FRONT, limit(SIDE_BUY, 50, 5));
+    l.im.add_limit(Implied::BACK, limit(SIDE_SELL, 40, 5));
+    const uint32_t bid = 50 - 40 + CENTER;
+    EXPECT_EQ(l.im.implied_price(Implied::SPREAD, SIDE_BUY), bid);
+
+    EXPECT_EQ(l.im.add_limit(Implied::SPREAD, limit(SIDE_SELL, bid, 5)), TestEngine::DONE_FILL);
+    EXPECT_EQ(l.front->best_bid(), TestEngine::NO_PRICE);
+    EXPECT_EQ(l.back->best_ask(), TestEngine::NO_PRICE);
+    EXPECT_EQ(l.im.implied_price(Implied::SPREAD, SIDE_BUY), TestEngine::NO_PRICE);
+}
+
+TEST(Implied, PostOnlyRejectedAgainstImpliedPrice) {
+    Legs l;
+    l.im.add_limit(Implied::BACK, limit(SIDE_SELL, 100, 10));
+    l.im.add_limit(Implied::SPREAD, limit(SIDE_SELL, CENTER, 10));
+    EXPECT_EQ(l.im.add_limit(Implied::FRONT, limit(SIDE_BUY, 100, 5, ORDER_POST_ONLY)), TestEngine::NIL);
+    EXPECT_EQ(l.im.implied_trades(), 0u);
+}
+
+// The own touch equals the implied price but holds only an all-or-none maker larger than the
+// incoming order: the order must take the implied price instead of retrying its own book
+TEST(Implied, AllOrNoneTouchDoesNotBlockImpliedPrice) {
+    Legs l;
+    const uint32_t aon = l.im.add_limit(Implied::FRONT, limit(SIDE_SELL, 100, 50, ORDER_AON));
+    l.im.add_limit(Implied::BACK, limit(SIDE_SELL, 100, 10));
+    l.im.add_limit(Implied::SPREAD, limit(SIDE_SELL, CENTER, 10));
+
+    EXPECT_EQ(l.im.add_limit(Implied::FRONT, limit(SIDE_BUY, 100, 10)), TestEngine::DONE_FILL);
+    EXPECT_EQ(l.im.implied_volume(), 10u);
+    EXPECT_EQ(l.front->best_ask_qty(), 50u);
+    EXPECT_TRUE(l.im.cancel(Implied::FRONT, aon));
+}
+
+TEST(Implied, MinimumQuantityTouchDoesNotBlockImpliedPrice) {
+    Legs l;
+    l.im.add_limit(Implied::FRONT, limit(SIDE_SELL, 100, 20, 0, 15));
+    l.im.add_limit(Implied::BACK, limit(SIDE_SELL, 100, 10));
+    l.im.add_limit(Implied::SPREAD, limit(SIDE_SELL, CENTER, 10));
+
+    EXPECT_EQ(l.im.add_limit(Implied::FRONT, limit(SIDE_BUY, 100, 5)), TestEngine::DONE_FILL);
+    EXPECT_EQ(l.im.implied_volume(), 5u);
+    EXPECT_EQ(l.front->best_ask_qty(), 20u);
+}
@@ -0,0 +1,62 @@
+// Per-producer lanes: round-robin draining, or global arrival order in sequenced mode
+#include <gtest/gtest.h>
+#include <vector>
+#include "MpscLanes.hpp"
+
+namespace {
+
+std::vector<uint32_t> drain(MpscLanes<uint32_t>& q) {
+    std::vector<uint32_t> out;
+    MpscLanes<uint32_t>::Ticket t;
+    while (const uint32_t* v = q.peek(t)) {
+        out.push_back(*v);
+        q.release(t);
+    }
+    return out;
+}
+
+} // namespace
+
+TEST(Lanes, RoundRobinOneMessagePerLane) {
+    MpscLanes<uint32_t> q(8, 3);
+    q.push(0, 1); q.push(0, 2); q.push(0, 3);
+    q.push(2, 21);
+    q.push(1, 11); q.push(1, 12);
+    EXPECT_EQ(q.size(), 6u);
+    EXPECT_EQ(drain(q), (std::vector<uint32_t>{1, 11, 21, 2, 12, 3}));
+    EXPECT_TRUE(q.empty());
+}
+
+TEST(Lanes, EachLaneStaysInOrder) {
+    MpscLanes<uint32_t> q(4, 2);
+    for (uint32_t v = 0; v < 4; ++v) ASSERT_TRUE(q.push(1, v));
+    EXPECT_FALSE(q.push(1, 4)); // a full lane does not spill into another
+    EXPECT_TRUE(q.push(0, 100));
+    EXPECT_EQ(drain(q), (std::vector<uint32_t>{100, 0, 1, 2, 3}));
+}
+
+TEST(Lanes, SequencedKeepsArrivalOrderAcrossLanes) {
+    MpscLanes<uint32_t> q(8, 3, true);
+    const uint32_t lane_of[] = {2, 2, 0, 1, 2, 0};
+    for (uint32_t v = 0; v < 6; ++v) ASSERT_TRUE(q.push(lane_of[v], v));
+    EXPECT_EQ(drain(q), (std::vector<uint32_t>{0, 1, 2, 3, 4, 5}));
+}
+
+// A claimed but uncommitted number holds back every later one, whichever lane it is on
+TEST(Lanes, SequencedWaitsForAnUncommittedClaim) {
+    MpscLanes<uint32_t> q(8, 2, true);
+    size_t ticket;
+    uint32_t* cell = q.claim(0, ticket); // number 0
+    ASSERT_NE(cell, nullptr);
+    q.push(1, 1);
+    q.push(1, 2);
+
+    MpscLanes<uint32_t>::Ticket t;
+    EXPECT_EQ(q.peek(t), nullptr);
+    EXPECT_EQ(q.size(), 3u); // the held head of lane 1 still counts
+
+    *cell = 0;
+    q.commit(0, ticket);
+    EXPECT_EQ(drain(q), (std::vector<uint32_t>{0, 1, 2}));
+    EXPECT_TRUE(q.empty());
+}
@@ -0,0 +1,99 @@
+// Bulk loading a sorted book into an empty ladder
+#include <gtest/gtest.h>
+#include <vector>
+#include "BookTest.hpp"
+
+namespace {
+
+struct Columns {
+    std::vector<uint8_t> side;
+    std::vector<uint32_t> tick, qty;
+
+    void add(uint8_t s, uint32_t t, uint32_t q) { side.push_back(s); tick.push_back(t); qty.push_back(q); }
+    BulkOrders view() const { return BulkOrders{side.data(), tick.data(), qty.data(), nullptr, side.size()}; }
+};
+
+// two orders on each of bids 95..99 and asks 101..105
+Columns deep_book() {
+    Columns c;
+    for (uint32_t t = 95; t <= 99; ++t) { c.add(SIDE_BUY, t, t - 90); c.add(SIDE_BUY, t, 1); }
+    for (uint32_t t = 101; t <= 105; ++t) { c.add(SIDE_SELL, t, t - 100); c.add(SIDE_SELL, t, 1); }
+    return c;
+}
+
+} // namespace
+
+TEST(Load, SameBookAsAddingOneByOne) {
+    const Columns c = deep_book();
+    auto loaded = make_engine();
+    auto added = make_engine();
+    std::vector<uint32_t> handles(c.side.size());
+    ASSERT_TRUE(loaded->load(c.view(), handles.data()));
+    for (size_t i = 0; i < c.side.size(); ++i)
+        EXPECT_EQ(added->add_limit(limit(c.side[i], c.tick[i], c.qty[i])), handles[i]);
+
+    EXPECT_EQ(loaded->state_hash(), added->state_hash());
+    EXPECT_EQ(loaded->best_bid(), 99u);
+    EXPECT_EQ(loaded->best_ask(), 101u);
+    EXPECT_EQ(loaded->best_bid_qty(), 10u);
+    EXPECT_EQ(loaded->best_ask_qty(), 2u);
+    EXPECT_EQ(loaded->total_trades(), 0u);
+}
+
+TEST(Load, LoadedBookMatchesInTimePriority) {
+    const Columns c = deep_book();
+    auto eng = make_engine();
+    std::vector<uint32_t> handles(c.side.size());
+    ASSERT_TRUE(eng->load(c.view(), handles.data()));
+
+    EXPECT_EQ(eng->add_limit(limit(SIDE_BUY, 102, 4)), TestEngine::DONE_FILL); // 101: 1 + 1, 102: 2
+    EXPECT_EQ(eng->total_volume(), 4u);
+    EXPECT_FALSE(eng->cancel(handles[10]));
+    EXPECT_FALSE(eng->cancel(handles[11]));
+    EXPECT_TRUE(eng->cancel(handles[13]));
+    EXPECT_EQ(eng->best_ask(), 103u);
+}
+
+TEST(Load, QueueIndexLearnsLoadedOrders) {
+    const Columns c = deep_book();
+    auto eng = make_engine();
+    ASSERT_TRUE(eng->enable_queue_position(true));
+    std::vector<uint32_t> handles(c.side.size());
+    ASSERT_TRUE(eng->load(c.view(), handles.data()));
+    EXPECT_EQ(eng->queue_ahead(handles[8]), 0u);
+    EXPECT_EQ(eng->queue_ahead(handles[9]), 9u);
+}
+
+TEST(Load, RejectsBadInputWithoutLoading) {
+    auto eng = make_engine();
+
+    Columns unsorted;
+    unsorted.add(SIDE_BUY, 99, 1);
+    unsorted.add(SIDE_BUY, 98, 1);
+    EXPECT_FALSE(eng->load(unsorted.view(), nullptr));
+
+    Columns crossed;
+    crossed.add(SIDE_BUY, 101, 1);
+    crossed.add(SIDE_SELL, 100, 1);
+    EXPECT_FALSE(eng->load(crossed.view(), nullptr));
+
+    Columns range;
+    range.add(SIDE_SELL, 256, 1);
+    EXPECT_FALSE(eng->load(range.view(), nullptr));
+
+    Columns zero;
+    zero.add(SIDE_SELL, 100, 0);
+    EXPECT_FALSE(eng->load(zero.view(), nullptr));
+
+    EXPECT_EQ(eng->best_bid(), TestEngine::NO_PRICE);
+    EXPECT_EQ(eng->best_ask(), TestEngine::NO_PRICE);
+    EXPECT_EQ(eng->state_hash(), 0u);
+}
+
+TEST(Load, RefusesNonEmptyBook) {
+    auto eng = make_engine();
+    eng->add_limit(limit(SIDE_BUY, 50, 1));
+    EXPECT_FALSE(eng->load(deep_book().view(), nullptr));
+    EXPECT_EQ(eng->best_bid(), 50u);
+    EXPECT_EQ(eng->best_ask(), TestEngine::NO_PRICE);
+}
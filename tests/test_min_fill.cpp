@@ -0,0 +1,106 @@
+// All-or-none and minimum-quantity orders, as makers and as takers
+#include <gtest/gtest.h>
+#include "BookTest.hpp"
+
+TEST(MinFill, SmallTakerPassesOverAllOrNoneMaker) {
+    auto eng = make_engine();
+    const uint32_t aon = eng->add_limit(limit(SIDE_SELL, 100, 10, ORDER_AON));
+    const uint32_t plain = eng->add_limit(limit(SIDE_SELL, 100, 5));
+    EXPECT_EQ(eng->best_ask_free_qty(), 5u);
+
+    EXPECT_EQ(eng->add_limit(limit(SIDE_BUY, 100, 5)), TestEngine::DONE_FILL);
+    EXPECT_FALSE(eng->cancel(plain));
+    EXPECT_EQ(eng->best_ask_qty(), 10u);
+
+    // large enough now: the all-or-none maker trades in one go
+    EXPECT_EQ(eng->add_limit(limit(SIDE_BUY, 100, 10)), TestEngine::DONE_FILL);
+    EXPECT_FALSE(eng->cancel(aon));
+    EXPECT_EQ(eng->best_ask(), TestEngine::NO_PRICE);
+}
+
+TEST(MinFill, SweepSatisfiesEveryMinimum) {
+    auto eng = make_engine();
+    eng->add_limit(limit(SIDE_SELL, 100, 10, ORDER_AON));
+    eng->add_limit(limit(SIDE_SELL, 100, 5, 0, 5));
+    EXPECT_EQ(eng->add_limit(limit(SIDE_BUY, 100, 15)), TestEngine::DONE_FILL);
+    EXPECT_EQ(eng->total_trades(), 2u);
+    EXPECT_EQ(eng->state_hash(), 0u);
+}
+
+TEST(MinFill, TakerThatCannotMeetItsMinimumIsRejected) {
+    auto eng = make_engine();
+    eng->add_limit(limit(SIDE_SELL, 100, 3));
+    EXPECT_EQ(eng->add_limit(limit(SIDE_BUY, 100, 10, 0, 5)), TestEngine::NIL);
+    EXPECT_EQ(eng->total_trades(), 0u);
+    EXPECT_EQ(eng->add_limit(limit(SIDE_BUY, 100, 10, ORDER_AON)), TestEngine::NIL);
+    EXPECT_EQ(eng->best_ask_qty(), 3u);
+}
+
+TEST(MinFill, AllOrNoneTakerAcrossLevels) {
+    auto eng = make_engine();
+    eng->add_limit(limit(SIDE_SELL, 100, 6));
+    eng->add_limit(limit(SIDE_SELL, 101, 6));
+    EXPECT_EQ(eng->add_limit(limit(SIDE_BUY, 101, 10, ORDER_AON)), TestEngine::DONE_FILL);
+    EXPECT_EQ(eng->total_volume(), 10u);
+    EXPECT_EQ(eng->best_ask_qty(), 2u);
+}
+
+TEST(MinFill, PartlyFilledMakerKeepsItsMinimumUpToItsSize) {
+    auto eng = make_engine();
+    eng->add_limit(limit(SIDE_SELL, 100, 10, 0, 4));
+    EXPECT_EQ(eng->add_limit(limit(SIDE_BUY, 100, 6)), TestEngine::DONE_FILL);
+    EXPECT_EQ(eng->best_ask_qty(), 4u);
+
+    // 2 is below the maker's minimum; the buy rests a tick behind it rather than through it
+    const uint32_t small = eng->add_limit(limit(SIDE_BUY, 100, 2));
+    ASSERT_NE(small, TestEngine::NIL);
+    EXPECT_EQ(eng->best_bid(), 99u);
+    EXPECT_TRUE(eng->cancel(small));
+    EXPECT_EQ(eng->add_limit(limit(SIDE_BUY, 100, 4)), TestEngine::DONE_FILL);
+}
+
+TEST(MinFill, TradesBehindMakersItIsTooSmallFor) {
+    auto eng = make_engine();
+    const uint32_t aon = eng->add_limit(limit(SIDE_SELL, 100, 10, ORDER_AON));
+    eng->add_limit(limit(SIDE_SELL, 101, 5));
+    EXPECT_EQ(eng->add_limit(limit(SIDE_BUY, 101, 5)), TestEngine::DONE_FILL);
+    EXPECT_EQ(eng->profile().volume_at(101), 5u);
+    EXPECT_EQ(eng->best_ask(), 100u);
+    EXPECT_TRUE(eng->cancel(aon));
+}
+
+TEST(MinFill, HiddenOrdersTakeNoMinimum) {
+    auto eng = make_engine();
+    eng->add_limit(limit(SIDE_SELL, 100, 10, ORDER_HIDDEN, 8));
+    EXPECT_EQ(eng->add_limit(limit(SIDE_BUY, 100, 2)), TestEngine::DONE_FILL);
+    EXPECT_EQ(eng->total_volume(), 2u);
+}
+
+// A partly filled order keeps its fill and rests its remainder a tick behind the maker it is too small for
+TEST(MinFill, RemainderRestsBehindMakerItIsTooSmallFor) {
+    auto eng = make_engine();
+    eng->add_limit(limit(SIDE_SELL, 100, 3));
+    const uint32_t aon = eng->add_limit(limit(SIDE_SELL, 101, 10, ORDER_AON));
+    const uint32_t h = eng->add_limit(limit(SIDE_BUY, 102, 8));
+    ASSERT_NE(h, TestEngine::NIL);
+    ASSERT_NE(h, TestEngine::DONE_FILL);
+    EXPECT_EQ(eng->total_volume(), 3u);
+    EXPECT_EQ(eng->best_bid(), 100u);
+    EXPECT_EQ(eng->best_bid_qty(), 5u);
+    EXPECT_EQ(eng->best_ask(), 101u);
+    EXPECT_TRUE(eng->cancel(h));
+    EXPECT_TRUE(eng->cancel(aon));
+}
+
+TEST(MinFill, SellRemainderRestsBehindMakerItIsTooSmallFor) {
+    auto eng = make_engine();
+    eng->add_limit(limit(SIDE_BUY, 100, 3));
+    eng->add_limit(limit(SIDE_BUY, 99, 10, ORDER_AON));
+    const uint32_t h = eng->add_limit(limit(SIDE_SELL, 98, 8));
+    ASSERT_NE(h, TestEngine::NIL);
+    ASSERT_NE(h, TestEngine::DONE_FILL);
+    EXPECT_EQ(eng->total_volume(), 3u);
+    EXPECT_EQ(eng->best_ask(), 100u);
+    EXPECT_EQ(eng->best_ask_qty(), 5u);
+    EXPECT_EQ(eng->best_bid(), 99u);
+}
@@ -0,0 +1,112 @@
+// Midpoint and primary pegs: priced from the lit BBO when liquidity is taken
+#include <gtest/gtest.h>
+#include "BookTest.hpp"
+
+TEST(Peg, PrimaryTradesAheadOfLitAtSamePrice) {
+    auto eng = make_engine();
+    eng->add_limit(limit(SIDE_BUY, 50, 5));
+    const uint32_t p = eng->add_limit(peg(SIDE_BUY, PEG_PRIMARY, 10));
+    ASSERT_NE(p, TestEngine::NIL);
+
+    EXPECT_EQ(eng->add_limit(limit(SIDE_SELL, 50, 12)), TestEngine::DONE_FILL);
+    EXPECT_EQ(eng->total_trades(), 2u);
+    EXPECT_EQ(eng->best_bid_qty(), 3u);
+    EXPECT_FALSE(eng->cancel(p));
+}
+
+TEST(Peg, PrimaryFollowsTheTouch) {
+    auto eng = make_engine();
+    eng->add_limit(limit(SIDE_BUY, 50, 5));
+    eng->add_limit(peg(SIDE_BUY, PEG_PRIMARY, 10)); // at the bid: 50
+    eng->add_limit(limit(SIDE_BUY, 52, 5));         // the peg moves up to 52, still ahead
+
+    EXPECT_EQ(eng->add_limit(limit(SIDE_SELL, 52, 12)), TestEngine::DONE_FILL);
+    EXPECT_EQ(eng->profile().volume_at(52), 12u);
+    EXPECT_EQ(eng->total_trades(), 2u);
+    EXPECT_EQ(eng->best_bid(), 52u);
+    EXPECT_EQ(eng->best_bid_qty(), 3u);
+}
+
+TEST(Peg, OffsetPegRestsBehindTheTouch) {
+    auto eng = make_engine();
+    eng->add_limit(limit(SIDE_BUY, 50, 5));
+    eng->add_limit(peg(SIDE_BUY, PEG_PRIMARY, 10, 2)); // 48
+    eng->add_limit(limit(SIDE_BUY, 49, 5));
+
+    // 50 trades, then 49; the peg (now at 49 - 2 = 47) is out of the seller's reach
+    EXPECT_EQ(eng->add_limit(limit(SIDE_SELL, 48, 20, ORDER_IOC)), TestEngine::NIL);
+    EXPECT_EQ(eng->total_volume(), 10u);
+    EXPECT_EQ(eng->best_bid(), TestEngine::NO_PRICE);
+}
+
+TEST(Peg, MidpointPegsUncrossOnEvenSpread) {
+    auto eng = make_engine();
+    eng->add_limit(limit(SIDE_BUY, 40, 1));
+    eng->add_limit(limit(SIDE_SELL, 50, 1));
+    eng->add_limit(peg(SIDE_BUY, PEG_MID, 5));
+    EXPECT_EQ(eng->total_trades(), 0u);
+    eng->add_limit(peg(SIDE_SELL, PEG_MID, 3));
+    EXPECT_EQ(eng->total_trades(), 1u);
+    EXPECT_EQ(eng->profile().volume_at(45), 3u);
+}
+
+TEST(Peg, UnanchoredPegDoesNotTrade) {
+    auto eng = make_engine();
+    eng->add_limit(limit(SIDE_SELL, 60, 1)); // no bid: buy mid pegs have no price
+    const uint32_t p = eng->add_limit(peg(SIDE_BUY, PEG_MID, 5));
+    ASSERT_NE(p, TestEngine::NIL);
+    EXPECT_EQ(eng->add_limit(limit(SIDE_SELL, 1, 5, ORDER_IOC)), TestEngine::NIL);
+    EXPECT_EQ(eng->total_trades(), 0u);
+    EXPECT_TRUE(eng->cancel(p));
+    EXPECT_NE(eng->state_hash(), 0u); // the lit ask still rests
+}
+
+TEST(Peg, IocPegIsRejected) {
+    auto eng = make_engine();
+    OrderIn in = peg(SIDE_BUY, PEG_MID, 5);
+    in.flags = ORDER_IOC;
+    EXPECT_EQ(eng->add_limit(in), TestEngine::NIL);
+}
+
+// A peg priced through a hidden order trades with it whichever of the two arrives first
+TEST(Peg, MidPegAfterHiddenInsideSpreadTrades) {
+    auto eng = make_engine();
+    eng->add_limit(limit(SIDE_BUY, 98, 1));
+    eng->add_limit(limit(SIDE_SELL, 102, 1));
+    eng->add_limit(limit(SIDE_SELL, 100, 5, ORDER_HIDDEN));
+    EXPECT_EQ(eng->add_limit(peg(SIDE_BUY, PEG_MID, 3)), TestEngine::DONE_FILL);
+    EXPECT_EQ(eng->total_volume(), 3u);
+    EXPECT_EQ(eng->profile().volume_at(100), 3u);
+    EXPECT_EQ(eng->best_ask(), 102u);
+}
+
+TEST(Peg, HiddenAfterMidPegTrades) {
+    auto eng = make_engine();
+    eng->add_limit(limit(SIDE_BUY, 98, 1));
+    eng->add_limit(limit(SIDE_SELL, 102, 1));
+    const uint32_t p = eng->add_limit(peg(SIDE_BUY, PEG_MID, 3));
+    const uint32_t h = eng->add_limit(limit(SIDE_SELL, 100, 5, ORDER_HIDDEN));
+    ASSERT_NE(h, TestEngine::NIL);
+    ASSERT_NE(h, TestEngine::DONE_FILL);
+    EXPECT_EQ(eng->total_volume(), 3u);
+    EXPECT_EQ(eng->profile().volume_at(100), 3u);
+    EXPECT_FALSE(eng->cancel(p));
+    EXPECT_TRUE(eng->cancel(h)); // 2 left resting
+}
+
+TEST(Peg, RepricedPegReachesHiddenOrder) {
+    auto eng = make_engine();
+    eng->add_limit(limit(SIDE_BUY, 96, 1));
+    const uint32_t ask = eng->add_limit(limit(SIDE_SELL, 102, 1));
+    eng->add_limit(limit(SIDE_SELL, 104, 1));
+    eng->add_limit(limit(SIDE_SELL, 100, 2, ORDER_HIDDEN));
+    const uint32_t p = eng->add_limit(peg(SIDE_BUY, PEG_MID, 5)); // at 99: short of the hidden sell
+    ASSERT_NE(p, TestEngine::NIL);
+    ASSERT_NE(p, TestEngine::DONE_FILL);
+    EXPECT_EQ(eng->total_trades(), 0u);
+
+    EXPECT_TRUE(eng->cancel(ask)); // the mid moves to 100
+    EXPECT_EQ(eng->total_volume(), 2u);
+    EXPECT_EQ(eng->profile().volume_at(100), 2u);
+    EXPECT_TRUE(eng->cancel(p)); // 3 left resting
+}
@@ -0,0 +1,73 @@
+// Queue-position index: quantity ahead of a resting order, kept through fills, cancels and amends
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+#include "BookTest.hpp"
+
+TEST(QueuePosition, AheadFollowsFillsCancelsAndAmends) {
+    auto eng = make_engine();
+    ASSERT_TRUE(eng->enable_queue_position(true));
+    const uint32_t a = eng->add_limit(limit(SIDE_BUY, 50, 10));
+    const uint32_t b = eng->add_limit(limit(SIDE_BUY, 50, 20));
+    const uint32_t c = eng->add_limit(limit(SIDE_BUY, 50, 30));
+    EXPECT_EQ(eng->queue_ahead(a), 0u);
+    EXPECT_EQ(eng->queue_ahead(b), 10u);
+    EXPECT_EQ(eng->queue_ahead(c), 30u);
+
+    eng->add_limit(limit(SIDE_SELL, 50, 15)); // a filled, 5 off b
+    EXPECT_EQ(eng->queue_ahead(a), TestEngine::NO_POSITION);
+    EXPECT_EQ(eng->queue_ahead(b), 0u);
+    EXPECT_EQ(eng->queue_ahead(c), 15u);
+
+    EXPECT_TRUE(eng->amend(b, 50, 4));
+    EXPECT_EQ(eng->queue_ahead(c), 4u);
+    EXPECT_TRUE(eng->cancel(b));
+    EXPECT_EQ(eng->queue_ahead(c), 0u);
+}
+
+TEST(QueuePosition, SweptLevelStartsOver) {
+    auto eng = make_engine();
+    ASSERT_TRUE(eng->enable_queue_position(true));
+    eng->add_limit(limit(SIDE_SELL, 100, 5));
+    eng->add_limit(limit(SIDE_SELL, 100, 5));
+    EXPECT_EQ(eng->add_limit(limit(SIDE_BUY, 100, 10)), TestEngine::DONE_FILL);
+    const uint32_t h = eng->add_limit(limit(SIDE_SELL, 100, 3));
+    EXPECT_EQ(eng->queue_ahead(h), 0u);
+}
+
+TEST(QueuePosition, MatchesWalkOnRandomFlow) {
+    auto indexed = make_engine();
+    auto walked = make_engine();
+    ASSERT_TRUE(indexed->enable_queue_position(true));
+    std::mt19937 rng(7);
+    std::vector<uint32_t> live;
+    for (uint32_t step = 0; step < 50000; ++step) {
+        if (rng() % 3 == 0 && !live.empty()) {
+            const size_t k = rng() % live.size();
+            ASSERT_EQ(indexed->cancel(live[k]), walked->cancel(live[k]));
+            live[k] = live.back();
+            live.pop_back();
+        } else {
+            const uint8_t side = rng() % 2;
+            const OrderIn in = limit(side, side == SIDE_BUY ? 95 + rng() % 8 : 100 + rng() % 8, 1 + rng() % 9);
+            const uint32_t r = indexed->add_limit(in);
+            ASSERT_EQ(r, walked->add_limit(in));
+            if (r != TestEngine::NIL && r != TestEngine::DONE_FILL) live.push_back(r);
+        }
+        if (!live.empty()) {
+            const uint32_t h = live[rng() % live.size()];
+            ASSERT_EQ(indexed->queue_ahead(h), walked->queue_ahead(h)) << "step " << step;
+        }
+    }
+}
+
+TEST(QueuePosition, RefusedOnNonEmptyBook) {
+    auto eng = make_engine();
+    eng->add_limit(limit(SIDE_BUY, 50, 10));
+    EXPECT_FALSE(eng->enable_queue_position(true));
+    eng->add_limit(limit(SIDE_SELL, 50, 10));
+    EXPECT_TRUE(eng->enable_queue_position(true));
+    const uint32_t h = eng->add_limit(limit(SIDE_BUY, 50, 10));
+    EXPECT_EQ(eng->queue_ahead(h), 0u);
+    EXPECT_TRUE(eng->enable_queue_position(false));
+}
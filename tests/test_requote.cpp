@@ -0,0 +1,118 @@
+// Requoting a resting order by handle: amend in place, move, or pull
+#include <gtest/gtest.h>
+#include "BookTest.hpp"
+#include "InstrumentBook.hpp"
+
+TEST(Requote, SmallerSizeAmendsInPlaceAndKeepsPriority) {
+    auto eng = make_engine();
+    const uint32_t q = eng->add_limit(limit(SIDE_BUY, 100, 10));
+    const uint32_t other = eng->add_limit(limit(SIDE_BUY, 100, 5));
+    EXPECT_EQ(eng->requote(q, SIDE_BUY, 100, 6), q);
+    EXPECT_EQ(eng->best_bid_qty(), 11u);
+
+    EXPECT_EQ(eng->add_limit(limit(SIDE_SELL, 100, 6)), TestEngine::DONE_FILL);
+    EXPECT_FALSE(eng->cancel(q)); // still first in the queue: filled
+    EXPECT_TRUE(eng->cancel(other));
+    EXPECT_EQ(eng->state_hash(), 0u);
+}
+
+TEST(Requote, LargerSizeRequeues) {
+    auto eng = make_engine();
+    const uint32_t q = eng->add_limit(limit(SIDE_BUY, 100, 10));
+    const uint32_t other = eng->add_limit(limit(SIDE_BUY, 100, 5));
+    const uint32_t bigger = eng->requote(q, SIDE_BUY, 100, 12);
+    ASSERT_NE(bigger, TestEngine::NIL);
+    EXPECT_FALSE(eng->cancel(q));
+
+    EXPECT_EQ(eng->add_limit(limit(SIDE_SELL, 100, 5)), TestEngine::DONE_FILL);
+    EXPECT_FALSE(eng->cancel(other)); // now ahead of the requoted order
+    EXPECT_EQ(eng->best_bid_qty(), 12u);
+}
+
+TEST(Requote, NewPriceMovesTheQuote) {
+    auto eng = make_engine();
+    eng->add_limit(limit(SIDE_SELL, 104, 3));
+    const uint32_t q = eng->add_limit(limit(SIDE_BUY, 100, 10));
+    const uint32_t moved = eng->requote(q, SIDE_BUY, 101, 10);
+    ASSERT_NE(moved, TestEngine::NIL);
+    EXPECT_EQ(eng->best_bid(), 101u);
+    EXPECT_FALSE(eng->cancel(q));
+
+    // a move through the other side trades like any new order
+    EXPECT_EQ(eng->requote(moved, SIDE_BUY, 104, 3), TestEngine::DONE_FILL);
+    EXPECT_EQ(eng->best_bid(), TestEngine::NO_PRICE);
+    EXPECT_EQ(eng->state_hash(), 0u);
+}
+
+TEST(Requote, ZeroSizePullsTheQuote) {
+    auto eng = make_engine();
+    const uint32_t q = eng->add_limit(limit(SIDE_SELL, 105, 4));
+    EXPECT_EQ(eng->requote(q, SIDE_SELL, 105, 0), TestEngine::NIL);
+    EXPECT_EQ(eng->best_ask(), TestEngine::NO_PRICE);
+    EXPECT_FALSE(eng->cancel(q));
+}
+
+TEST(Requote, NilHandlePlacesANewQuote) {
+    auto eng = make_engine();
+    EXPECT_EQ(eng->requote(TestEngine::NIL, SIDE_SELL, 105, 0), TestEngine::NIL);
+    EXPECT_EQ(eng->state_hash(), 0u);
+    const uint32_t q = eng->requote(TestEngine::NIL, SIDE_SELL, 105, 3);
+    ASSERT_NE(q, TestEngine::NIL);
+    EXPECT_EQ(eng->best_ask(), 105u);
+    EXPECT_TRUE(eng->cancel(q));
+}
+
+// A mass-quote entry replaces both sides of the maker's previous quote on the book
+TEST(Requote, MassQuoteEntryAmendsBothSides) {
+    auto eng = make_engine();
+    HandleTracker tracker;
+    QuoteSlot slot;
+    MatchCounters c;
+    applyQuote(*eng, tracker, slot, 1, 0, QuoteEntry{.bid_tick=98, .bid_qty=10, .ask_tick=102, .ask_qty=10}, c);
+    ASSERT_NE(slot.bid, TestEngine::NIL);
+    ASSERT_NE(slot.ask, TestEngine::NIL);
+    const QuoteSlot first = slot;
+
+    applyQuote(*eng, tracker, slot, 1, 0, QuoteEntry{.bid_tick=98, .bid_qty=8, .ask_tick=102, .ask_qty=6}, c);
+    EXPECT_EQ(slot.bid, first.bid);
+    EXPECT_EQ(slot.ask, first.ask);
+    EXPECT_EQ(c.quote_sides, 4u);
+    EXPECT_EQ(c.quote_amends, 2u);
+    EXPECT_EQ(eng->best_bid_qty(), 8u);
+    EXPECT_EQ(eng->best_ask_qty(), 6u);
+}
+
+// A quote filled since the last entry is placed again, never amending whoever now holds its handle
+TEST(Requote, MassQuoteSkipsAFilledSide) {
+    auto eng = make_engine();
+    HandleTracker tracker;
+    QuoteSlot slot;
+    MatchCounters c;
+    applyQuote(*eng, tracker, slot, 1, 0, QuoteEntry{.bid_tick=98, .bid_qty=5, .ask_tick=102, .ask_qty=5}, c);
+    EXPECT_EQ(eng->add_limit(limit(SIDE_SELL, 98, 5)), TestEngine::DONE_FILL);
+    const uint32_t client = eng->add_limit(limit(SIDE_BUY, 97, 4));
+    tracker.track(7, client);
+
+    applyQuote(*eng, tracker, slot, 1, 0, QuoteEntry{.bid_tick=97, .bid_qty=0, .ask_tick=102, .ask_qty=5}, c);
+    EXPECT_EQ(slot.bid, TestEngine::NIL);
+    EXPECT_EQ(eng->best_bid(), 97u);
+    EXPECT_EQ(eng->best_bid_qty(), 4u);
+    EXPECT_TRUE(tracker.cancel(*eng, 7));
+}
+
+// Handles are unique across a group, so one book must not move another book's quote
+TEST(Requote, GroupRejectsHandleOfAnotherBook) {
+    TestGroup group(2, 1000);
+    const uint32_t h = group.add_limit(0, limit(SIDE_BUY, 1050, 10));
+    ASSERT_NE(h, TestGroup::NIL);
+    const uint64_t hash0 = group.state_hash(0);
+
+    EXPECT_EQ(group.requote(1, h, SIDE_BUY, 1050, 5), TestGroup::NIL);
+    EXPECT_EQ(group.requote(1, h, SIDE_BUY, 1060, 5), TestGroup::NIL);
+    EXPECT_EQ(group.requote(1, h, SIDE_BUY, 1050, 0), TestGroup::NIL);
+    EXPECT_EQ(group.state_hash(0), hash0);
+    EXPECT_EQ(group.best_bid(1), TestGroup::NO_PRICE);
+
+    EXPECT_EQ(group.requote(0, h, SIDE_BUY, 1050, 5), h);
+    EXPECT_TRUE(group.cancel(h));
+}
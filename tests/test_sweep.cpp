@@ -0,0 +1,67 @@
+// Whole-level sweeps: a taker that takes a level's entire quantity retires its FIFO in one splice
+#include <gtest/gtest.h>
+#include "BookTest.hpp"
+
+TEST(Sweep, RetiresEveryMakerAcrossLevels) {
+    auto eng = make_engine();
+    uint32_t h[5];
+    h[0] = eng->add_limit(limit(SIDE_SELL, 100, 5));
+    h[1] = eng->add_limit(limit(SIDE_SELL, 100, 5));
+    h[2] = eng->add_limit(limit(SIDE_SELL, 100, 5));
+    h[3] = eng->add_limit(limit(SIDE_SELL, 101, 10));
+    h[4] = eng->add_limit(limit(SIDE_SELL, 101, 10));
+
+    const uint32_t r = eng->add_limit(limit(SIDE_BUY, 101, 40));
+    ASSERT_NE(r, TestEngine::NIL);
+    ASSERT_NE(r, TestEngine::DONE_FILL); // 5 left over rest as the new bid
+
+    EXPECT_EQ(eng->total_trades(), 5u);
+    EXPECT_EQ(eng->total_volume(), 35u);
+    EXPECT_EQ(eng->best_ask(), TestEngine::NO_PRICE);
+    EXPECT_EQ(eng->best_bid(), 101u);
+    EXPECT_EQ(eng->best_bid_qty(), 5u);
+    for (uint32_t handle : h) EXPECT_FALSE(eng->cancel(handle));
+    EXPECT_EQ(eng->profile().volume_at(100), 15u);
+    EXPECT_EQ(eng->profile().trades_at(101), 2u);
+}
+
+TEST(Sweep, PartialLevelKeepsTimePriority) {
+    auto eng = make_engine();
+    const uint32_t first = eng->add_limit(limit(SIDE_BUY, 50, 5));
+    const uint32_t second = eng->add_limit(limit(SIDE_BUY, 50, 5));
+
+    EXPECT_EQ(eng->add_limit(limit(SIDE_SELL, 50, 7)), TestEngine::DONE_FILL);
+    EXPECT_EQ(eng->total_trades(), 2u);
+    EXPECT_EQ(eng->best_bid_qty(), 3u);
+    EXPECT_FALSE(eng->cancel(first));
+    EXPECT_TRUE(eng->cancel(second));
+    EXPECT_EQ(eng->best_bid(), TestEngine::NO_PRICE);
+}
+
+TEST(Sweep, SweptLevelIsReusable) {
+    auto eng = make_engine();
+    eng->add_limit(limit(SIDE_SELL, 100, 4));
+    eng->add_limit(limit(SIDE_SELL, 100, 6));
+    EXPECT_EQ(eng->add_limit(limit(SIDE_BUY, 100, 10)), TestEngine::DONE_FILL);
+    EXPECT_EQ(eng->best_ask(), TestEngine::NO_PRICE);
+    EXPECT_EQ(eng->state_hash(), 0u);
+
+    const uint32_t h = eng->add_limit(limit(SIDE_SELL, 100, 3));
+    EXPECT_EQ(eng->best_ask(), 100u);
+    EXPECT_EQ(eng->best_ask_qty(), 3u);
+    EXPECT_EQ(eng->add_limit(limit(SIDE_BUY, 100, 3)), TestEngine::DONE_FILL);
+    EXPECT_FALSE(eng->cancel(h));
+    EXPECT_EQ(eng->state_hash(), 0u);
+}
+
+TEST(Sweep, ReleasedNodesAreReused) {
+    auto eng = make_engine();
+    // far more orders than one pool segment would hold if swept nodes leaked
+    const uint32_t capacity = eng->pool_capacity();
+    for (uint32_t round = 0; round < 200; ++round) {
+        for (uint32_t i = 0; i < 1000; ++i) eng->add_limit(limit(SIDE_SELL, 100 + i % 8, 1));
+        ASSERT_EQ(eng->add_limit(limit(SIDE_BUY, 107, 1000)), TestEngine::DONE_FILL);
+    }
+    EXPECT_EQ(eng->pool_capacity(), capacity);
+    EXPECT_EQ(eng->total_volume(), 200000u);
+}
@@ -0,0 +1,135 @@
+// Matching worker message handling, run to completion on the test thread
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include "MatchingWorker.hpp"
+
+namespace {
+
+constexpr uint32_t TICK = Config::MAX_TICKS / 2;
+
+OrderMsg add(uint64_t client, uint8_t side, uint32_t tick, uint32_t qty, uint32_t instrument = 0) {
+    OrderMsg m{};
+    m.client_id = client;
+    m.side = side;
+    m.price_tick = tick;
+    m.qty = qty;
+    m.instrument = instrument;
+    return m;
+}
+
+OrderMsg migrate(uint32_t instrument, uint32_t to) {
+    OrderMsg m{};
+    m.msg_type = MessageType::MIGRATE_OUT;
+    m.instrument = instrument;
+    m.worker_id = to;
+    return m;
+}
+
+OrderMsg cancel(uint32_t client, uint32_t instrument = 0) {
+    OrderMsg m{};
+    m.msg_type = MessageType::CANCEL_ORDER;
+    m.handle_to_cancel = client;
+    m.instrument = instrument;
+    return m;
+}
+
+// One worker per ring, all messages queued up front; each run() drains its ring and returns
+struct Pipeline {
+    explicit Pipeline(uint32_t instruments, uint32_t workers, bool cancel_lane)
+        : dir(instruments, workers) {
+        for (uint32_t w = 0; w < workers; ++w) {
+            rings.push_back(std::make_unique<MpscLanes<OrderMsg>>(64, 1));
+            if (cancel_lane) cancels.push_back(std::make_unique<MpscLanes<OrderMsg>>(64, 1));
+        }
+    }
+
+    void run(uint32_t worker) {
+        MatchingWorker w(worker, *rings[worker], cancels.empty() ? nullptr : cancels[worker].get(), orders, stats, cfg,
+                         done, dir);
+        w();
+    }
+
+    Config cfg;
+    OrderManager orders;
+    Stats stats;
+    std::atomic<bool> done{true};
+    InstrumentDirectory dir;
+    std::vector<std::unique_ptr<MpscLanes<OrderMsg>>> rings, cancels;
+};
+
+} // namespace
+
+// A cancel that overtook its add in the priority lane waits for that add, then applies
+TEST(Worker, HeldCancelAppliesWhenItsAddArrives) {
+    Pipeline p(1, 1, true);
+    p.cancels[0]->push(0, cancel(2));
+    p.rings[0]->push(0, add(1, SIDE_BUY, TICK - 2, 5));
+    p.rings[0]->push(0, add(2, SIDE_BUY, TICK - 1, 5));
+    p.run(0);
+
+    EXPECT_EQ(p.stats.cancels.load(), 1u);
+    EXPECT_EQ(p.dir.book(0).engine.best_bid(), TICK - 2);
+    EXPECT_TRUE(p.dir.book(0).held_cancels.empty());
+}
+
+TEST(Worker, HeldCancelWaitsPastEarlierAdds) {
+    Pipeline p(1, 1, true);
+    p.cancels[0]->push(0, cancel(3));
+    p.rings[0]->push(0, add(1, SIDE_BUY, TICK - 3, 5));
+    p.rings[0]->push(0, add(2, SIDE_BUY, TICK - 2, 5));
+    p.rings[0]->push(0, cancel(1));
+    p.rings[0]->push(0, add(3, SIDE_BUY, TICK - 1, 5));
+    p.run(0);
+
+    EXPECT_EQ(p.stats.cancels.load(), 2u);
+    EXPECT_EQ(p.dir.book(0).engine.best_bid(), TICK - 2);
+    EXPECT_EQ(p.dir.book(0).engine.best_bid_qty(), 5u);
+}
+
+// Messages reaching the new owner before the book are parked, then replayed in order on adoption
+TEST(Worker, ParkedMessagesReplayOnAdopt) {
+    Pipeline p(2, 2, false);
+    p.rings[1]->push(0, add(1, SIDE_BUY, TICK - 1, 5));
+    p.rings[1]->push(0, add(2, SIDE_SELL, TICK - 1, 3));
+    p.rings[1]->push(0, add(3, SIDE_SELL, TICK + 4, 1, 1)); // worker 1's own instrument
+    p.rings[0]->push(0, migrate(0, 1));
+
+    std::thread to([&] { p.run(1); });
+    while (!p.rings[1]->empty()) std::this_thread::yield(); // everything taken: instrument 0 parked
+    p.run(0);
+    to.join();
+
+    const InstrumentBook& book = p.dir.book(0);
+    EXPECT_EQ(book.owner_worker.load(), 1);
+    EXPECT_EQ(book.engine.total_volume(), 3u);
+    EXPECT_EQ(book.engine.best_bid(), TICK - 1);
+    EXPECT_EQ(book.engine.best_bid_qty(), 2u);
+    EXPECT_EQ(p.dir.book(1).engine.best_ask(), TICK + 4);
+}
+
+// A deferred ring is built by its worker; producers wait for ready() before pushing
+TEST(Worker, DeferredRingIsBuiltByItsWorker) {
+    Pipeline p(1, 1, true);
+    p.rings[0] = std::make_unique<MpscLanes<OrderMsg>>(64, 1, false, true);
+    p.cancels[0] = std::make_unique<MpscLanes<OrderMsg>>(64, 1, false, true);
+    EXPECT_FALSE(p.rings[0]->ready());
+    p.done = false;
+
+    std::thread worker([&] { p.run(0); });
+    while (!p.rings[0]->ready() || !p.cancels[0]->ready()) std::this_thread::yield();
+    p.rings[0]->push(0, add(1, SIDE_SELL, TICK + 1, 5));
+    while (!p.rings[0]->empty()) std::this_thread::yield();
+    p.done = true;
+    worker.join();
+
+    EXPECT_EQ(p.dir.book(0).engine.best_ask(), TICK + 1);
+}
+
+TEST(Worker, DirectoryBuildsEveryBookInParallel) {
+    InstrumentDirectory dir(7, 3);
+    for (uint32_t i = 0; i < 7; ++i) {
+        EXPECT_EQ(dir.book(i).id, i);
+        EXPECT_EQ(dir.book(i).engine.state_hash(), 0u);
+    }
+}